@@ -0,0 +1,98 @@
+#ifndef RAYTRACER_AABB_HPP
+#define RAYTRACER_AABB_HPP
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <algorithm>
+
+// axis-aligned bounding box
+// (methods are defined inline since they sit on the hot path of BVH traversal)
+
+struct AABB {
+	glm::vec3 min;
+	glm::vec3 max;
+
+	// starts out empty (inverted), so expanding by any point makes it valid
+	AABB()
+		: min(std::numeric_limits<float>::max()),
+		  max(-std::numeric_limits<float>::max()) {}
+
+	AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+	void expand(const glm::vec3& point)
+	{
+		this->min = glm::min(this->min, point);
+		this->max = glm::max(this->max, point);
+	}
+
+	void expand(const AABB& other)
+	{
+		this->min = glm::min(this->min, other.min);
+		this->max = glm::max(this->max, other.max);
+	}
+
+	bool isEmpty() const
+	{
+		return this->min.x > this->max.x ||
+			this->min.y > this->max.y ||
+			this->min.z > this->max.z;
+	}
+
+	glm::vec3 getCentroid() const
+	{
+		return (this->min + this->max) * 0.5f;
+	}
+
+	float getSurfaceArea() const
+	{
+		if (this->isEmpty()) {
+			return 0.0f;
+		}
+		glm::vec3 extent = this->max - this->min;
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+	int getLongestAxis() const
+	{
+		glm::vec3 extent = this->max - this->min;
+		if (extent.x >= extent.y && extent.x >= extent.z) {
+			return 0;
+		}
+		return extent.y >= extent.z ? 1 : 2;
+	}
+
+	// slab test, taking the reciprocal of the ray direction so it can be computed
+	// once per ray instead of once per box. If return is true, *t_near is set to
+	// the (clamped to zero) distance at which the ray enters the box.
+	bool doesRayIntersect(
+		const glm::vec3& origin,
+		const glm::vec3& inverse_direction,
+		const float& t_max,
+		float* const& t_near
+	) const
+	{
+		float t0 = 0.0f;
+		float t1 = t_max;
+		for (int axis = 0; axis < 3; axis++) {
+			float t_a = (this->min[axis] - origin[axis]) * inverse_direction[axis];
+			float t_b = (this->max[axis] - origin[axis]) * inverse_direction[axis];
+			if (t_a > t_b) {
+				std::swap(t_a, t_b);
+			}
+			// conservatively widen for rounding error, so rays grazing the edge of a
+			// flat box (e.g. around a single axis-aligned triangle) aren't rejected
+			t_b *= 1.0f + 2.0f * 3.0f * std::numeric_limits<float>::epsilon();
+			// written so that NaNs (0 * inf on a slab boundary) don't reject the box
+			t0 = t_a > t0 ? t_a : t0;
+			t1 = t_b < t1 ? t_b : t1;
+			if (t0 > t1) {
+				return false;
+			}
+		}
+		*t_near = t0;
+		return true;
+	}
+};
+
+
+#endif //RAYTRACER_AABB_HPP
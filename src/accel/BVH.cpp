@@ -0,0 +1,310 @@
+#include <glm/glm.hpp>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "AABB.hpp"
+#include "SharedArray.hpp"
+#include "BVH.hpp"
+
+namespace {
+	// number of candidate split planes evaluated per axis
+	const int bin_count = 16;
+	// leaves are never split below this size
+	const uint32_t min_leaf_size = 2;
+	// ...and always split above this size, even if SAH says otherwise
+	const uint32_t max_leaf_size = 16;
+	// keeps traversal stack (see BVH::intersect) from overflowing
+	const size_t max_depth = 60;
+	// relative cost of a node (box) test vs. a primitive test
+	const float traversal_cost = 0.5f;
+
+	struct Bin {
+		AABB bounds;
+		uint32_t count = 0;
+	};
+}
+
+BVH::BVH(const std::vector<AABB>& primitive_bounds)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	this->build_stats.primitive_count = primitive_bounds.size();
+	if (primitive_bounds.empty()) {
+		return;
+	}
+
+	std::vector<glm::vec3> centroids;
+	centroids.reserve(primitive_bounds.size());
+	for (const AABB& bounds : primitive_bounds) {
+		centroids.push_back(bounds.getCentroid());
+	}
+
+	std::vector<uint32_t> primitive_indices;
+	primitive_indices.reserve(primitive_bounds.size());
+	for (size_t i = 0, len = primitive_bounds.size(); i < len; i++) {
+		primitive_indices.push_back((uint32_t)i);
+	}
+
+	// a binary tree with at most one primitive per leaf has at most 2n - 1 nodes
+	std::vector<BVHNode> nodes;
+	nodes.reserve(2 * primitive_bounds.size() - 1);
+	this->buildRecursive(
+		&nodes,
+		&primitive_indices,
+		primitive_bounds,
+		centroids,
+		0,
+		(uint32_t)primitive_bounds.size(),
+		1
+	);
+	nodes.shrink_to_fit();
+	this->nodes = SharedArray<BVHNode>(std::move(nodes));
+	this->primitive_indices = SharedArray<uint32_t>(std::move(primitive_indices));
+
+	this->build_stats.node_count = this->nodes.size();
+	this->computeExpectedCosts();
+
+	this->build_stats.build_milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+}
+
+BVH::BVH(
+	const SharedArray<BVHNode>& nodes,
+	const SharedArray<uint32_t>& primitive_indices,
+	const BVHBuildStats& build_stats
+) : nodes(nodes),
+    primitive_indices(primitive_indices),
+    build_stats(build_stats) {}
+
+uint32_t BVH::buildRecursive(
+	std::vector<BVHNode>* const& nodes,
+	std::vector<uint32_t>* const& primitive_indices,
+	const std::vector<AABB>& primitive_bounds,
+	const std::vector<glm::vec3>& centroids,
+	uint32_t begin,
+	uint32_t end,
+	size_t depth
+)
+{
+	auto node_index = (uint32_t)nodes->size();
+	nodes->emplace_back();
+
+	AABB bounds;
+	AABB centroid_bounds;
+	for (uint32_t i = begin; i < end; i++) {
+		bounds.expand(primitive_bounds[(*primitive_indices)[i]]);
+		centroid_bounds.expand(centroids[(*primitive_indices)[i]]);
+	}
+	(*nodes)[node_index].bounds = bounds;
+	this->build_stats.max_depth = std::max(this->build_stats.max_depth, depth);
+
+	uint32_t count = end - begin;
+	int axis = centroid_bounds.getLongestAxis();
+	float axis_extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+
+	// all centroids coincide (or we're out of stack): no split will separate them
+	bool must_be_leaf =
+		count <= min_leaf_size || depth >= max_depth || axis_extent <= 0.0f;
+
+	// binned SAH: drop centroids into equal-width bins along each axis,
+	// then sweep the bin boundaries as candidate split planes
+	float best_cost = std::numeric_limits<float>::max();
+	int best_axis = -1;
+	int best_split = -1;
+	for (int a = 0; !must_be_leaf && a < 3; a++) {
+		float a_min = centroid_bounds.min[a];
+		float a_extent = centroid_bounds.max[a] - a_min;
+		if (a_extent <= 0.0f) {
+			continue;
+		}
+		Bin bins[bin_count];
+		float scale = bin_count / a_extent;
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t primitive = (*primitive_indices)[i];
+			int b = std::min(
+				bin_count - 1,
+				(int)((centroids[primitive][a] - a_min) * scale)
+			);
+			bins[b].count++;
+			bins[b].bounds.expand(primitive_bounds[primitive]);
+		}
+
+		// sweep right-to-left to find the area/count of everything above each split
+		float right_areas[bin_count - 1];
+		uint32_t right_counts[bin_count - 1];
+		AABB right_bounds;
+		uint32_t right_count = 0;
+		for (int b = bin_count - 1; b > 0; b--) {
+			right_bounds.expand(bins[b].bounds);
+			right_count += bins[b].count;
+			right_areas[b - 1] = right_bounds.getSurfaceArea();
+			right_counts[b - 1] = right_count;
+		}
+
+		// ...then left-to-right to evaluate each split
+		AABB left_bounds;
+		uint32_t left_count = 0;
+		for (int b = 0; b < bin_count - 1; b++) {
+			left_bounds.expand(bins[b].bounds);
+			left_count += bins[b].count;
+			if (left_count == 0 || right_counts[b] == 0) {
+				continue;
+			}
+			float cost = left_bounds.getSurfaceArea() * left_count +
+				right_areas[b] * right_counts[b];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = a;
+				best_split = b;
+			}
+		}
+	}
+
+	if (!must_be_leaf && best_axis >= 0) {
+		// normalize against parent area, and compare with cost of not splitting
+		float parent_area = bounds.getSurfaceArea();
+		float split_cost = parent_area > 0.0f ?
+			traversal_cost + best_cost / parent_area :
+			std::numeric_limits<float>::max();
+		if (split_cost >= count && count <= max_leaf_size) {
+			must_be_leaf = true;
+		}
+	}
+
+	uint32_t middle = begin;
+	if (!must_be_leaf) {
+		if (best_axis >= 0) {
+			axis = best_axis;
+			float a_min = centroid_bounds.min[axis];
+			float scale = bin_count / (centroid_bounds.max[axis] - a_min);
+			middle = (uint32_t)(std::partition(
+				primitive_indices->begin() + begin,
+				primitive_indices->begin() + end,
+				[&](uint32_t primitive) {
+					int b = std::min(
+						bin_count - 1,
+						(int)((centroids[primitive][axis] - a_min) * scale)
+					);
+					return b <= best_split;
+				}
+			) - primitive_indices->begin());
+		}
+		if (middle == begin || middle == end) {
+			// binning couldn't separate primitives; fall back to a median split
+			middle = begin + count / 2;
+			std::nth_element(
+				primitive_indices->begin() + begin,
+				primitive_indices->begin() + middle,
+				primitive_indices->begin() + end,
+				[&](uint32_t primitive_a, uint32_t primitive_b) {
+					return centroids[primitive_a][axis] < centroids[primitive_b][axis];
+				}
+			);
+		}
+	}
+
+	if (must_be_leaf) {
+		if (count > std::numeric_limits<uint16_t>::max()) {
+			throw std::runtime_error("BVH leaf too large.");
+		}
+		(*nodes)[node_index].offset = begin;
+		(*nodes)[node_index].primitive_count = (uint16_t)count;
+		(*nodes)[node_index].axis = 0;
+		this->build_stats.leaf_count++;
+		this->build_stats.max_leaf_size =
+			std::max(this->build_stats.max_leaf_size, (size_t)count);
+		return node_index;
+	}
+
+	this->buildRecursive(
+		nodes,
+		primitive_indices,
+		primitive_bounds,
+		centroids,
+		begin,
+		middle,
+		depth + 1
+	);
+	uint32_t right_index = this->buildRecursive(
+		nodes,
+		primitive_indices,
+		primitive_bounds,
+		centroids,
+		middle,
+		end,
+		depth + 1
+	);
+	(*nodes)[node_index].offset = right_index;
+	(*nodes)[node_index].primitive_count = 0;
+	(*nodes)[node_index].axis = (uint16_t)axis;
+	return node_index;
+}
+
+void BVH::computeExpectedCosts()
+{
+	// probability of a random ray hitting a node, given that it hits the root,
+	// is proportional to the ratio of their surface areas
+	float root_area = this->nodes[0].bounds.getSurfaceArea();
+	if (root_area <= 0.0f) {
+		this->build_stats.expected_node_tests = 1.0;
+		this->build_stats.expected_primitive_tests = this->build_stats.primitive_count;
+		return;
+	}
+	double node_tests = 0.0;
+	double primitive_tests = 0.0;
+	for (const BVHNode& node : this->nodes) {
+		double probability = node.bounds.getSurfaceArea() / root_area;
+		node_tests += probability;
+		if (node.isLeaf()) {
+			primitive_tests += probability * node.primitive_count;
+		}
+	}
+	this->build_stats.expected_node_tests = node_tests;
+	this->build_stats.expected_primitive_tests = primitive_tests;
+}
+
+bool BVH::isEmpty() const
+{
+	return this->nodes.empty();
+}
+
+AABB BVH::getBounds() const
+{
+	return this->nodes.empty() ? AABB() : this->nodes[0].bounds;
+}
+
+const BVHBuildStats& BVH::getBuildStats() const
+{
+	return this->build_stats;
+}
+
+const SharedArray<BVHNode>& BVH::getNodes() const
+{
+	return this->nodes;
+}
+
+const SharedArray<uint32_t>& BVH::getPrimitiveIndices() const
+{
+	return this->primitive_indices;
+}
+
+void BVH::markPrimitivesReordered()
+{
+	std::vector<uint32_t> primitive_indices;
+	primitive_indices.reserve(this->primitive_indices.size());
+	for (size_t i = 0, len = this->primitive_indices.size(); i < len; i++) {
+		primitive_indices.push_back((uint32_t)i);
+	}
+	this->primitive_indices = SharedArray<uint32_t>(std::move(primitive_indices));
+}
+
+BVHTraversalStats& BVH::getTraversalStats()
+{
+	static thread_local BVHTraversalStats stats;
+	return stats;
+}
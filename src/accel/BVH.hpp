@@ -0,0 +1,365 @@
+#ifndef RAYTRACER_BVH_HPP
+#define RAYTRACER_BVH_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AABB.hpp"
+#include "SharedArray.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+
+// Bounding volume hierarchy over an arbitrary set of primitives, described only by
+// their bounding boxes. Built with a binned surface area heuristic (SAH) and stored
+// as a flat array of nodes in depth-first order, so a node's left child always
+// directly follows it and only the right child's index needs storing.
+
+struct BVHNode {
+	AABB bounds;
+	// interior node: index of right child (left child is at this node's index + 1)
+	// leaf node: index of first entry in BVH primitive_indices
+	uint32_t offset;
+	// 0 for interior nodes
+	uint16_t primitive_count;
+	// axis the node was split along (used to pick near child first)
+	uint16_t axis;
+
+	bool isLeaf() const
+	{
+		return this->primitive_count > 0;
+	}
+};
+
+struct BVHBuildStats {
+	size_t primitive_count = 0;
+	size_t node_count = 0;
+	size_t leaf_count = 0;
+	size_t max_depth = 0;
+	size_t max_leaf_size = 0;
+	double build_milliseconds = 0.0;
+	// expected number of primitive intersection tests for a random ray
+	// hitting the root bounds, according to the surface area heuristic
+	double expected_primitive_tests = 0.0;
+	// ...and the same for node (box) tests
+	double expected_node_tests = 0.0;
+};
+
+// per-thread counters, accumulated during traversal (a packet traversal counts
+// once, as do each of its node visits and primitive tests)
+struct BVHTraversalStats {
+	unsigned long long rays = 0;
+	unsigned long long nodes_visited = 0;
+	unsigned long long primitive_tests = 0;
+};
+
+class BVH {
+private:
+	SharedArray<BVHNode> nodes;
+	SharedArray<uint32_t> primitive_indices;
+	BVHBuildStats build_stats;
+	uint32_t buildRecursive(
+		std::vector<BVHNode>* const& nodes,
+		std::vector<uint32_t>* const& primitive_indices,
+		const std::vector<AABB>& primitive_bounds,
+		const std::vector<glm::vec3>& centroids,
+		uint32_t begin,
+		uint32_t end,
+		size_t depth
+	);
+	void computeExpectedCosts();
+public:
+	BVH() = default;
+	explicit BVH(const std::vector<AABB>& primitive_bounds);
+	// a BVH built earlier (see MeshCache), from its nodes and primitive indices
+	BVH(
+		const SharedArray<BVHNode>& nodes,
+		const SharedArray<uint32_t>& primitive_indices,
+		const BVHBuildStats& build_stats
+	);
+	bool isEmpty() const;
+	AABB getBounds() const;
+	const BVHBuildStats& getBuildStats() const;
+	const SharedArray<BVHNode>& getNodes() const;
+	const SharedArray<uint32_t>& getPrimitiveIndices() const;
+	// For callers that store their primitives in their own arrays: once those are
+	// permuted into the order of getPrimitiveIndices(), this resets that order to
+	// the identity, so traversal passes positions in the caller's (now leaf-ordered)
+	// arrays and each leaf's primitives sit next to each other in memory.
+	void markPrimitivesReordered();
+	static BVHTraversalStats& getTraversalStats();
+	// Finds the closest primitive hit along the ray, front-to-back.
+	// intersect_primitive is called as intersect_primitive(primitive_index, t) where
+	// *t holds the closest distance found so far. It should return true (and
+	// update *t) only if it finds a hit closer than *t.
+	// If return is true, *t is set to the closest hit distance.
+	template <typename PrimitiveIntersector>
+	bool intersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float* const& t,
+		PrimitiveIntersector intersect_primitive
+	) const;
+	// Finds whether the ray hits any primitive before t_max, stopping as soon as
+	// one does. is_primitive_occluding is called as
+	// is_primitive_occluding(primitive_index), and should return true if that
+	// primitive is hit before t_max.
+	template <typename PrimitiveOccluder>
+	bool isOccluded(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max,
+		PrimitiveOccluder is_primitive_occluding
+	) const;
+	// Packet version of intersect, visiting each node that any of the packet's rays
+	// enters before its closest hit so far. intersect_primitive is called as
+	// intersect_primitive(primitive_index), and should update the packet's closest
+	// hits (see RayPacket), returning a mask of lanes it updated.
+	// Returns a mask of lanes hit.
+	template <typename PrimitivePacketIntersector>
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels,
+		PrimitivePacketIntersector intersect_primitive
+	) const;
+	// Packet version of isOccluded, finding which of the packet's rays hit any
+	// primitive before their t (see RayPacket), and stopping once all of them have.
+	// Each node is visited once for every ray still looking. Lanes are deactivated
+	// as they're found to be occluded. occluded_lanes is called as
+	// occluded_lanes(primitive_index), and should return a mask of the lanes whose
+	// rays hit that primitive before their t.
+	// Returns a mask of lanes occluded.
+	template <typename PrimitivePacketOccluder>
+	unsigned int occludePacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels,
+		PrimitivePacketOccluder occluded_lanes
+	) const;
+};
+
+template <typename PrimitiveIntersector>
+bool BVH::intersect(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float* const& t,
+	PrimitiveIntersector intersect_primitive
+) const
+{
+	if (this->nodes.empty()) {
+		return false;
+	}
+
+	BVHTraversalStats& stats = BVH::getTraversalStats();
+	stats.rays++;
+
+	glm::vec3 inverse_direction = 1.0f / direction;
+	bool direction_is_negative[3] = {
+		direction.x < 0.0f,
+		direction.y < 0.0f,
+		direction.z < 0.0f
+	};
+
+	bool does_intersect = false;
+	float t_node;
+
+	// explicit stack of node indices still to visit
+	uint32_t stack[64];
+	size_t stack_size = 0;
+	uint32_t node_index = 0;
+	while (true) {
+		const BVHNode& node = this->nodes[node_index];
+		stats.nodes_visited++;
+		if (node.bounds.doesRayIntersect(origin, inverse_direction, *t, &t_node)) {
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.primitive_count; i++) {
+					stats.primitive_tests++;
+					if (intersect_primitive(this->primitive_indices[node.offset + i], t)) {
+						does_intersect = true;
+					}
+				}
+			} else {
+				// visit the child nearest to the ray origin first, so that hits found
+				// there can cull the farther child
+				if (direction_is_negative[node.axis]) {
+					stack[stack_size++] = node_index + 1;
+					node_index = node.offset;
+				} else {
+					stack[stack_size++] = node.offset;
+					node_index = node_index + 1;
+				}
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+
+	return does_intersect;
+}
+
+template <typename PrimitiveOccluder>
+bool BVH::isOccluded(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max,
+	PrimitiveOccluder is_primitive_occluding
+) const
+{
+	if (this->nodes.empty()) {
+		return false;
+	}
+
+	BVHTraversalStats& stats = BVH::getTraversalStats();
+	stats.rays++;
+
+	glm::vec3 inverse_direction = 1.0f / direction;
+	float t_node;
+
+	// any hit will do, so unlike intersect, children are visited in fixed order
+	uint32_t stack[64];
+	size_t stack_size = 0;
+	uint32_t node_index = 0;
+	while (true) {
+		const BVHNode& node = this->nodes[node_index];
+		stats.nodes_visited++;
+		if (node.bounds.doesRayIntersect(origin, inverse_direction, t_max, &t_node)) {
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.primitive_count; i++) {
+					stats.primitive_tests++;
+					if (is_primitive_occluding(this->primitive_indices[node.offset + i])) {
+						return true;
+					}
+				}
+			} else {
+				stack[stack_size++] = node.offset;
+				node_index = node_index + 1;
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+
+	return false;
+}
+
+template <typename PrimitivePacketIntersector>
+unsigned int BVH::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels,
+	PrimitivePacketIntersector intersect_primitive
+) const
+{
+	if (this->nodes.empty() || packet->lane_mask == 0) {
+		return 0;
+	}
+
+	BVHTraversalStats& stats = BVH::getTraversalStats();
+	stats.rays++;
+
+	// rays in a packet are assumed coherent, so any active one can pick the
+	// near child for all of them
+	unsigned int lane = 0;
+	while (!(packet->lane_mask & (1u << lane))) {
+		lane++;
+	}
+	bool direction_is_negative[3] = {
+		packet->direction_x[lane] < 0.0f,
+		packet->direction_y[lane] < 0.0f,
+		packet->direction_z[lane] < 0.0f
+	};
+
+	unsigned int hit_mask = 0;
+
+	uint32_t stack[64];
+	size_t stack_size = 0;
+	uint32_t node_index = 0;
+	while (true) {
+		const BVHNode& node = this->nodes[node_index];
+		stats.nodes_visited++;
+		if (kernels.intersectBox(*packet, node.bounds)) {
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.primitive_count; i++) {
+					stats.primitive_tests++;
+					hit_mask |=
+						intersect_primitive(this->primitive_indices[node.offset + i]);
+				}
+			} else {
+				if (direction_is_negative[node.axis]) {
+					stack[stack_size++] = node_index + 1;
+					node_index = node.offset;
+				} else {
+					stack[stack_size++] = node.offset;
+					node_index = node_index + 1;
+				}
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+
+	return hit_mask;
+}
+
+template <typename PrimitivePacketOccluder>
+unsigned int BVH::occludePacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels,
+	PrimitivePacketOccluder occluded_lanes
+) const
+{
+	if (this->nodes.empty() || packet->lane_mask == 0) {
+		return 0;
+	}
+
+	BVHTraversalStats& stats = BVH::getTraversalStats();
+	stats.rays++;
+
+	unsigned int occluded_mask = 0;
+
+	// as with isOccluded, any hit will do, so children are visited in fixed order
+	uint32_t stack[64];
+	size_t stack_size = 0;
+	uint32_t node_index = 0;
+	while (true) {
+		const BVHNode& node = this->nodes[node_index];
+		stats.nodes_visited++;
+		if (kernels.intersectBox(*packet, node.bounds)) {
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.primitive_count; i++) {
+					stats.primitive_tests++;
+					unsigned int mask = packet->lane_mask &
+						occluded_lanes(this->primitive_indices[node.offset + i]);
+					if (mask) {
+						occluded_mask |= mask;
+						packet->deactivateLanes(mask);
+						if (packet->lane_mask == 0) {
+							return occluded_mask;
+						}
+					}
+				}
+			} else {
+				stack[stack_size++] = node.offset;
+				node_index = node_index + 1;
+				continue;
+			}
+		}
+		if (stack_size == 0) {
+			break;
+		}
+		node_index = stack[--stack_size];
+	}
+
+	return occluded_mask;
+}
+
+
+#endif //RAYTRACER_BVH_HPP
@@ -0,0 +1,316 @@
+#include <glm/glm.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#include <src/constants.hpp>
+#include <src/hashFile.hpp>
+
+#include "BVH.hpp"
+#include "SharedArray.hpp"
+#include "TriangleMesh.hpp"
+#include "MeshCache.hpp"
+
+namespace fs = boost::filesystem;
+namespace ipc = boost::interprocess;
+
+namespace {
+	// start of every cache file
+	const char cache_magic[] = "RTMESH02";
+
+	struct CacheHeader {
+		char magic[sizeof(cache_magic) - 1];
+		// sizes of the structures stored, as the build which wrote the cache has them
+		uint32_t vec3_size;
+		uint32_t node_size;
+		// .obj file the mesh was built from
+		uint64_t obj_size;
+		int64_t obj_modified_time;
+		uint64_t obj_hash;
+		uint64_t triangle_count;
+		// BVH build stats
+		uint64_t node_count;
+		uint64_t leaf_count;
+		uint64_t max_depth;
+		uint64_t max_leaf_size;
+		double build_milliseconds;
+		double expected_primitive_tests;
+		double expected_node_tests;
+	};
+
+	// arrays start on multiples of this, so they're as aligned in the mapped file
+	// as they would be on the heap
+	const size_t array_alignment = 16;
+
+	size_t alignOffset(size_t offset)
+	{
+		return (offset + array_alignment - 1) / array_alignment * array_alignment;
+	}
+
+	// offsets of each array in a cache file, which follow the header in this order
+	struct CacheLayout {
+		size_t nodes;
+		size_t vertices1;
+		size_t edges1_2;
+		size_t edges1_3;
+		size_t normals;
+		size_t primitive_indices;
+		size_t file_size;
+
+		CacheLayout(uint64_t triangle_count, uint64_t node_count)
+		{
+			size_t vec3_array_size = triangle_count * sizeof(glm::vec3);
+			this->nodes = alignOffset(sizeof(CacheHeader));
+			this->vertices1 = alignOffset(this->nodes + node_count * sizeof(BVHNode));
+			this->edges1_2 = alignOffset(this->vertices1 + vec3_array_size);
+			this->edges1_3 = alignOffset(this->edges1_2 + vec3_array_size);
+			this->normals = alignOffset(this->edges1_3 + vec3_array_size);
+			this->primitive_indices = alignOffset(this->normals + vec3_array_size);
+			this->file_size =
+				this->primitive_indices + triangle_count * sizeof(uint32_t);
+		}
+	};
+
+	template <typename T>
+	void writeArray(
+		std::ofstream* const& file,
+		size_t offset,
+		const SharedArray<T>& array
+	) {
+		// zero padding up to offset
+		std::vector<char> padding(offset - (size_t)file->tellp(), 0);
+		file->write(padding.data(), padding.size());
+		file->write((const char*)array.data(), array.size() * sizeof(T));
+	}
+
+	// deepest a node can be for BVH traversal, whose stacks hold 64 entries (builds
+	// stop splitting well before that)
+	const size_t max_node_depth = 64;
+
+	// whether traversing the BVH stays within its arrays: each interior node's
+	// children come after it (so there are no cycles) and within node_count, no
+	// node is too deep, and leaves and primitive indices stay within
+	// primitive_count. Cache files could have been cut short or altered since they
+	// were written.
+	bool isBVHInRange(
+		const BVHNode* const& nodes,
+		const size_t& node_count,
+		const uint32_t* const& primitive_indices,
+		const size_t& primitive_count
+	) {
+		std::vector<size_t> depths(node_count, 0);
+		for (size_t i = 0; i < node_count; i++) {
+			const BVHNode& node = nodes[i];
+			if (node.isLeaf()) {
+				if ((uint64_t)node.offset + node.primitive_count > primitive_count) {
+					return false;
+				}
+				continue;
+			}
+			if (
+				i + 1 >= node_count ||
+				node.offset <= i + 1 ||
+				node.offset >= node_count ||
+				depths[i] + 1 >= max_node_depth
+			) {
+				return false;
+			}
+			// (a child pointed to twice takes the deeper depth)
+			depths[i + 1] = std::max(depths[i + 1], depths[i] + 1);
+			depths[node.offset] = std::max(depths[node.offset], depths[i] + 1);
+		}
+		for (size_t i = 0; i < primitive_count; i++) {
+			if (primitive_indices[i] >= primitive_count) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename T>
+	SharedArray<T> mapArray(
+		const std::shared_ptr<const ipc::mapped_region>& region,
+		size_t offset,
+		size_t count
+	) {
+		const char* address = (const char*)region->get_address() + offset;
+		return SharedArray<T>(region, (const T*)address, count);
+	}
+}
+
+MeshCache::MeshCache(const std::string& obj_filename)
+	: obj_filename(obj_filename)
+{
+	boost::system::error_code error;
+	fs::path obj_path = fs::canonical(obj_filename, error);
+	if (error) {
+		obj_path = fs::absolute(obj_filename);
+	}
+	// beside the models directory, as the scene and models directories are
+	this->directory =
+		(obj_path.parent_path().parent_path() / cache_dir.filename()).string();
+	std::ostringstream name;
+	name << obj_path.stem().string() << "-" << std::hex
+		<< std::hash<std::string>()(obj_path.string()) << ".meshcache";
+	this->filename = (fs::path(this->directory) / name.str()).string();
+}
+
+const std::string& MeshCache::getFilename() const
+{
+	return this->filename;
+}
+
+bool MeshCache::load(TriangleMesh* const& mesh) const
+{
+	boost::system::error_code size_error;
+	boost::system::error_code time_error;
+	uint64_t obj_size = fs::file_size(this->obj_filename, size_error);
+	int64_t obj_modified_time = fs::last_write_time(this->obj_filename, time_error);
+	if (size_error || time_error || !fs::exists(this->filename)) {
+		return false;
+	}
+
+	std::shared_ptr<const ipc::mapped_region> region;
+	try {
+		ipc::file_mapping file(this->filename.c_str(), ipc::read_only);
+		region = std::make_shared<const ipc::mapped_region>(file, ipc::read_only);
+	} catch (const ipc::interprocess_exception&) {
+		return false;
+	}
+
+	if (region->get_size() < sizeof(CacheHeader)) {
+		return false;
+	}
+	CacheHeader header;
+	std::memcpy(&header, region->get_address(), sizeof(header));
+	if (
+		std::memcmp(header.magic, cache_magic, sizeof(header.magic)) != 0 ||
+		header.vec3_size != sizeof(glm::vec3) ||
+		header.node_size != sizeof(BVHNode) ||
+		header.obj_size != obj_size
+	) {
+		return false;
+	}
+	CacheLayout layout(header.triangle_count, header.node_count);
+	if (region->get_size() < layout.file_size) {
+		return false;
+	}
+	if (header.obj_modified_time != obj_modified_time) {
+		try {
+			if (hashFile(this->obj_filename) != header.obj_hash) {
+				return false;
+			}
+		} catch (const std::runtime_error&) {
+			return false;
+		}
+		// so the next load needn't hash it again (if this fails, it will)
+		std::fstream file(this->filename, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(offsetof(CacheHeader, obj_modified_time));
+		file.write((const char*)&obj_modified_time, sizeof(obj_modified_time));
+	}
+
+	const char* address = (const char*)region->get_address();
+	if (
+		!isBVHInRange(
+			(const BVHNode*)(address + layout.nodes),
+			header.node_count,
+			(const uint32_t*)(address + layout.primitive_indices),
+			header.triangle_count
+		)
+	) {
+		return false;
+	}
+
+	BVHBuildStats stats;
+	stats.primitive_count = header.triangle_count;
+	stats.node_count = header.node_count;
+	stats.leaf_count = header.leaf_count;
+	stats.max_depth = header.max_depth;
+	stats.max_leaf_size = header.max_leaf_size;
+	stats.build_milliseconds = header.build_milliseconds;
+	stats.expected_primitive_tests = header.expected_primitive_tests;
+	stats.expected_node_tests = header.expected_node_tests;
+
+	size_t triangle_count = header.triangle_count;
+	*mesh = TriangleMesh(
+		mapArray<glm::vec3>(region, layout.vertices1, triangle_count),
+		mapArray<glm::vec3>(region, layout.edges1_2, triangle_count),
+		mapArray<glm::vec3>(region, layout.edges1_3, triangle_count),
+		mapArray<glm::vec3>(region, layout.normals, triangle_count),
+		BVH(
+			mapArray<BVHNode>(region, layout.nodes, header.node_count),
+			mapArray<uint32_t>(region, layout.primitive_indices, triangle_count),
+			stats
+		)
+	);
+	return true;
+}
+
+bool MeshCache::save(const TriangleMesh& mesh) const
+{
+	const BVH& bvh = mesh.getBVH();
+	const BVHBuildStats& stats = bvh.getBuildStats();
+
+	CacheHeader header;
+	std::memcpy(header.magic, cache_magic, sizeof(header.magic));
+	header.vec3_size = sizeof(glm::vec3);
+	header.node_size = sizeof(BVHNode);
+	try {
+		header.obj_size = fs::file_size(this->obj_filename);
+		header.obj_modified_time = fs::last_write_time(this->obj_filename);
+		header.obj_hash = hashFile(this->obj_filename);
+	} catch (const std::runtime_error&) {
+		// including fs::filesystem_error
+		return false;
+	}
+	header.triangle_count = mesh.getTriangleCount();
+	header.node_count = bvh.getNodes().size();
+	header.leaf_count = stats.leaf_count;
+	header.max_depth = stats.max_depth;
+	header.max_leaf_size = stats.max_leaf_size;
+	header.build_milliseconds = stats.build_milliseconds;
+	header.expected_primitive_tests = stats.expected_primitive_tests;
+	header.expected_node_tests = stats.expected_node_tests;
+	CacheLayout layout(header.triangle_count, header.node_count);
+
+	boost::system::error_code error;
+	fs::create_directories(this->directory, error);
+	// named uniquely, so renders saving the same mesh at once don't write over each
+	// other's files before they're moved into place
+	std::string temporary_filename =
+		fs::unique_path(this->filename + ".%%%%-%%%%-%%%%.tmp", error).string();
+	if (error) {
+		return false;
+	}
+	{
+		std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+		file.write((const char*)&header, sizeof(header));
+		writeArray(&file, layout.nodes, bvh.getNodes());
+		writeArray(&file, layout.vertices1, mesh.getVertices1());
+		writeArray(&file, layout.edges1_2, mesh.getEdges1_2());
+		writeArray(&file, layout.edges1_3, mesh.getEdges1_3());
+		writeArray(&file, layout.normals, mesh.getNormals());
+		writeArray(&file, layout.primitive_indices, bvh.getPrimitiveIndices());
+		file.close();
+		if (!file) {
+			fs::remove(temporary_filename, error);
+			return false;
+		}
+	}
+	fs::rename(temporary_filename, this->filename, error);
+	return !error;
+}
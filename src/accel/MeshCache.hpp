@@ -0,0 +1,42 @@
+#ifndef RAYTRACER_MESHCACHE_HPP
+#define RAYTRACER_MESHCACHE_HPP
+
+#include <string>
+
+#include "TriangleMesh.hpp"
+
+// Binary copy of the TriangleMesh built from an .obj file: its triangle arrays and
+// BVH, laid out exactly as they are in memory. Loading one maps the file and
+// hands the mapped arrays to the mesh as they are, so nothing is parsed, built or
+// copied. Only the BVH's nodes and primitive indices are read up front, to check
+// they stay in range; the triangles' pages are read from disk as rays reach them.
+//
+// Each .obj file gets its own cache file, named after its path, in a cache_dir
+// beside the directory holding it (so models in models_dir are cached next to it,
+// wherever the program is run from). The cache records the .obj file's size,
+// modification time and hash, and is only used while the .obj file still matches
+// them: if just the modification time has changed (after a checkout, say), the
+// .obj file is hashed to check whether its contents have too.
+//
+// Cache files are only meant to be read by the build which wrote them, since
+// they store structures as that build lays them out.
+
+class MeshCache {
+private:
+	std::string obj_filename;
+	std::string directory;
+	std::string filename;
+public:
+	explicit MeshCache(const std::string& obj_filename);
+	const std::string& getFilename() const;
+	// if the cache is up to date with the .obj file, sets *mesh to the cached mesh
+	// and returns true. Returns false if it's missing, stale, unreadable or holds a
+	// BVH whose indices are out of range.
+	bool load(TriangleMesh* const& mesh) const;
+	// writes to a temporary file first, then moves it over the cache file.
+	// Returns false if it couldn't be written.
+	bool save(const TriangleMesh& mesh) const;
+};
+
+
+#endif //RAYTRACER_MESHCACHE_HPP
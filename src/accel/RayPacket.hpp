@@ -0,0 +1,91 @@
+#ifndef RAYTRACER_RAYPACKET_HPP
+#define RAYTRACER_RAYPACKET_HPP
+
+#include <glm/glm.hpp>
+#include <limits>
+
+class Object3D;
+
+// A group of rays traced together, stored as a structure of arrays so packet
+// kernels (see packetKernels.hpp) can load the same component of every ray into
+// one SIMD register. Lane i holds ray i, and bit i of a lane mask refers to it.
+//
+// Each lane also carries the closest hit found for its ray so far. Lanes without a
+// ray of their own still need a valid one (e.g. a copy of a neighbour's) to keep
+// NaNs out of the kernels, but are given a negative closest t so no hit ever counts.
+
+struct RayPacket {
+	static const unsigned int size = 8;
+	static const unsigned int all_lanes = (1u << size) - 1;
+
+	float origin_x[size];
+	float origin_y[size];
+	float origin_z[size];
+	float direction_x[size];
+	float direction_y[size];
+	float direction_z[size];
+	float inverse_direction_x[size];
+	float inverse_direction_y[size];
+	float inverse_direction_z[size];
+	// lanes holding a ray to be traced
+	unsigned int lane_mask = 0;
+
+	// closest hit so far
+	float t[size];
+	glm::vec3 normals[size];
+	Object3D* objects[size];
+
+	void setRay(
+		const unsigned int& lane,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const bool& active = true
+	) {
+		this->origin_x[lane] = origin.x;
+		this->origin_y[lane] = origin.y;
+		this->origin_z[lane] = origin.z;
+		this->direction_x[lane] = direction.x;
+		this->direction_y[lane] = direction.y;
+		this->direction_z[lane] = direction.z;
+		this->inverse_direction_x[lane] = 1.0f / direction.x;
+		this->inverse_direction_y[lane] = 1.0f / direction.y;
+		this->inverse_direction_z[lane] = 1.0f / direction.z;
+		this->t[lane] = active ?
+			std::numeric_limits<float>::max() :
+			-std::numeric_limits<float>::max();
+		this->objects[lane] = nullptr;
+		if (active) {
+			this->lane_mask |= 1u << lane;
+		} else {
+			this->lane_mask &= ~(1u << lane);
+		}
+	}
+
+	// leaves the lanes in mask out of any further tests, as if they had no ray
+	void deactivateLanes(const unsigned int& mask)
+	{
+		for (unsigned int lane = 0; lane < size; lane++) {
+			if (mask & (1u << lane)) {
+				this->t[lane] = -std::numeric_limits<float>::max();
+			}
+		}
+		this->lane_mask &= ~mask;
+	}
+
+	glm::vec3 getOrigin(const unsigned int& lane) const
+	{
+		return glm::vec3(this->origin_x[lane], this->origin_y[lane], this->origin_z[lane]);
+	}
+
+	glm::vec3 getDirection(const unsigned int& lane) const
+	{
+		return glm::vec3(
+			this->direction_x[lane],
+			this->direction_y[lane],
+			this->direction_z[lane]
+		);
+	}
+};
+
+
+#endif //RAYTRACER_RAYPACKET_HPP
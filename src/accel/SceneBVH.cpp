@@ -0,0 +1,179 @@
+#include <glm/glm.hpp>
+#include <vector>
+#include <limits>
+
+#include <src/entities/objects/Object3D.hpp>
+#include <src/profiling/Profiler.hpp>
+
+#include "AABB.hpp"
+#include "BVH.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+#include "SceneBVH.hpp"
+
+SceneBVH::SceneBVH(const std::vector<Object3D*>& scene_objects)
+{
+	PROFILE_SCOPE(build_scene_bvh);
+	std::vector<AABB> object_bounds;
+	for (Object3D* const& object : scene_objects) {
+		if (object->isBounded()) {
+			this->bounded_objects.push_back(object);
+			object_bounds.push_back(object->getBounds());
+		} else {
+			this->unbounded_objects.push_back(object);
+		}
+	}
+	this->bvh = BVH(object_bounds);
+}
+
+const BVH& SceneBVH::getBVH() const
+{
+	return this->bvh;
+}
+
+size_t SceneBVH::getUnboundedObjectCount() const
+{
+	return this->unbounded_objects.size();
+}
+
+bool SceneBVH::doesRayIntersect(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float* const& t,
+	glm::vec3* const& normal,
+	Object3D** const& object
+) const
+{
+	*t = std::numeric_limits<float>::max();
+
+	bool does_intersect = false;
+
+	float temp_t;
+	glm::vec3 temp_normal;
+	for (Object3D* const& unbounded_object : this->unbounded_objects) {
+		if (
+			unbounded_object->doesRayIntersect(origin, direction, &temp_t, &temp_normal) &&
+			temp_t < *t
+		) {
+			*t = temp_t;
+			*normal = temp_normal;
+			*object = unbounded_object;
+			does_intersect = true;
+		}
+	}
+
+	// the closest unbounded hit (if any) already limits how far the BVH is searched
+	bool does_intersect_bounded = this->bvh.intersect(
+		origin,
+		direction,
+		t,
+		[&](uint32_t object_index, float* const& closest_t) {
+			Object3D* bounded_object = this->bounded_objects[object_index];
+			if (
+				bounded_object->doesRayIntersect(origin, direction, &temp_t, &temp_normal) &&
+				temp_t < *closest_t
+			) {
+				*closest_t = temp_t;
+				*normal = temp_normal;
+				*object = bounded_object;
+				return true;
+			}
+			return false;
+		}
+	);
+
+	return does_intersect || does_intersect_bounded;
+}
+
+unsigned int SceneBVH::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	auto intersect_object = [&](Object3D* const& object) {
+		unsigned int mask = object->intersectPacket(packet, kernels);
+		for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+			if (mask & (1u << lane)) {
+				packet->objects[lane] = object;
+			}
+		}
+		return mask;
+	};
+
+	unsigned int hit_mask = 0;
+	for (Object3D* const& unbounded_object : this->unbounded_objects) {
+		hit_mask |= intersect_object(unbounded_object);
+	}
+
+	// as with single rays, unbounded hits already limit how far the BVH is searched
+	hit_mask |= this->bvh.intersectPacket(
+		packet,
+		kernels,
+		[&](uint32_t object_index) {
+			return intersect_object(this->bounded_objects[object_index]);
+		}
+	);
+
+	return hit_mask;
+}
+
+bool SceneBVH::isBlockingSegment(const glm::vec3& point_a, const glm::vec3& point_b) const
+{
+	PROFILE_SCOPE(shadow_test);
+	glm::vec3 segment = point_b - point_a;
+	float segment_length = glm::length(segment);
+	return this->isBlockingRay(point_a, segment / segment_length, segment_length);
+}
+
+unsigned int SceneBVH::occludePacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	PROFILE_SCOPE(shadow_test);
+	unsigned int occluded_mask = 0;
+	for (Object3D* const& unbounded_object : this->unbounded_objects) {
+		unsigned int mask = unbounded_object->intersectPacket(packet, kernels);
+		occluded_mask |= mask;
+		packet->deactivateLanes(mask);
+		if (packet->lane_mask == 0) {
+			return occluded_mask;
+		}
+	}
+
+	occluded_mask |= this->bvh.occludePacket(
+		packet,
+		kernels,
+		[&](uint32_t object_index) {
+			return this->bounded_objects[object_index]->intersectPacket(packet, kernels);
+		}
+	);
+
+	return occluded_mask;
+}
+
+bool SceneBVH::isBlockingRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max
+) const
+{
+	for (Object3D* const& unbounded_object : this->unbounded_objects) {
+		if (unbounded_object->isBlockingRay(origin, direction, t_max)) {
+			return true;
+		}
+	}
+
+	return this->bvh.isOccluded(
+		origin,
+		direction,
+		t_max,
+		[&](uint32_t object_index) {
+			return this->bounded_objects[object_index]->isBlockingRay(
+				origin,
+				direction,
+				t_max
+			);
+		}
+	);
+}
@@ -0,0 +1,64 @@
+#ifndef RAYTRACER_SCENEBVH_HPP
+#define RAYTRACER_SCENEBVH_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include <src/entities/objects/Object3D.hpp>
+
+#include "BVH.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+
+// Top-level acceleration structure over all objects in the scene.
+// Bounded objects are leaves of a BVH (models carry their own BVH over their
+// triangles, making this the upper level of a two-level hierarchy), while
+// unbounded objects (infinite planes) are kept in a side list which every
+// query tests directly.
+
+class SceneBVH {
+private:
+	// indexed by BVH primitive index
+	std::vector<Object3D*> bounded_objects;
+	std::vector<Object3D*> unbounded_objects;
+	BVH bvh;
+public:
+	SceneBVH() = default;
+	// objects are not owned, so must outlive the SceneBVH
+	explicit SceneBVH(const std::vector<Object3D*>& scene_objects);
+	const BVH& getBVH() const;
+	size_t getUnboundedObjectCount() const;
+	// if return is true, *t and *normal describe the closest intersection, which
+	// lies on *object
+	bool doesRayIntersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float* const& t,
+		glm::vec3* const& normal,
+		Object3D** const& object
+	) const;
+	// Packet version of doesRayIntersect, filling in the closest hit of each lane
+	// (see RayPacket). Returns a mask of lanes that hit anything.
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const;
+	// true if anything lies between the two points
+	bool isBlockingSegment(const glm::vec3& point_a, const glm::vec3& point_b) const;
+	// true if the ray hits anything with t < t_max, stopping at the first hit found
+	bool isBlockingRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) const;
+	// Packet version of isBlockingRay, where each lane's t is its t_max. Returns a
+	// mask of the lanes whose rays hit anything, which are deactivated (see
+	// RayPacket). The packet's closest hits are left meaningless.
+	unsigned int occludePacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const;
+};
+
+
+#endif //RAYTRACER_SCENEBVH_HPP
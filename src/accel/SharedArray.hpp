@@ -0,0 +1,65 @@
+#ifndef RAYTRACER_SHAREDARRAY_HPP
+#define RAYTRACER_SHAREDARRAY_HPP
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+// Read-only array whose elements live either in a vector of its own, or in memory
+// belonging to something else (such as a file mapped by MeshCache), which it keeps
+// alive for as long as any copy of the array exists. Copies share the elements.
+
+template <typename T>
+class SharedArray {
+private:
+	std::shared_ptr<const void> owner;
+	const T* elements;
+	size_t element_count;
+public:
+	SharedArray() : elements(nullptr), element_count(0) {}
+	explicit SharedArray(std::vector<T>&& elements)
+	{
+		std::shared_ptr<std::vector<T>> vector =
+			std::make_shared<std::vector<T>>(std::move(elements));
+		this->elements = vector->data();
+		this->element_count = vector->size();
+		this->owner = vector;
+	}
+	// elements must stay valid for as long as owner does
+	SharedArray(
+		const std::shared_ptr<const void>& owner,
+		const T* const& elements,
+		size_t element_count
+	) : owner(owner),
+	    elements(elements),
+	    element_count(element_count) {}
+
+	const T& operator[](size_t i) const
+	{
+		return this->elements[i];
+	}
+	const T* data() const
+	{
+		return this->elements;
+	}
+	size_t size() const
+	{
+		return this->element_count;
+	}
+	bool empty() const
+	{
+		return this->element_count == 0;
+	}
+	const T* begin() const
+	{
+		return this->elements;
+	}
+	const T* end() const
+	{
+		return this->elements + this->element_count;
+	}
+};
+
+
+#endif //RAYTRACER_SHAREDARRAY_HPP
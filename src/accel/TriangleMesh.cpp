@@ -0,0 +1,260 @@
+#include <glm/glm.hpp>
+#include <vector>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <src/constants.hpp>
+#include <src/profiling/Profiler.hpp>
+
+#include "AABB.hpp"
+#include "BVH.hpp"
+#include "SharedArray.hpp"
+#include "doesRayIntersectTriangle.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+#include "TriangleMesh.hpp"
+
+namespace {
+	// permutes data into BVH leaf order
+	template <typename T>
+	SharedArray<T> reorder(const std::vector<T>& data, const SharedArray<uint32_t>& order)
+	{
+		std::vector<T> reordered;
+		reordered.reserve(order.size());
+		for (uint32_t index : order) {
+			reordered.push_back(data[index]);
+		}
+		return SharedArray<T>(std::move(reordered));
+	}
+}
+
+TriangleMesh::TriangleMesh(
+	const std::vector<glm::vec3>& vertices,
+	const std::vector<uint32_t>& triangle_indices
+) {
+	if (triangle_indices.size() % 3 != 0) {
+		throw std::runtime_error("Triangle indices must come in groups of three.");
+	}
+
+	size_t triangle_count = triangle_indices.size() / 3;
+	std::vector<glm::vec3> vertices1;
+	std::vector<glm::vec3> edges1_2;
+	std::vector<glm::vec3> edges1_3;
+	std::vector<glm::vec3> normals;
+	vertices1.reserve(triangle_count);
+	edges1_2.reserve(triangle_count);
+	edges1_3.reserve(triangle_count);
+	normals.reserve(triangle_count);
+
+	std::vector<AABB> triangle_bounds;
+	triangle_bounds.reserve(triangle_count);
+	for (size_t i = 0, len = triangle_indices.size(); i < len; i += 3) {
+		const glm::vec3& vertex1 = vertices.at(triangle_indices[i]);
+		const glm::vec3& vertex2 = vertices.at(triangle_indices[i + 1]);
+		const glm::vec3& vertex3 = vertices.at(triangle_indices[i + 2]);
+		glm::vec3 edge1_2 = vertex2 - vertex1;
+		glm::vec3 edge1_3 = vertex3 - vertex1;
+		vertices1.push_back(vertex1);
+		edges1_2.push_back(edge1_2);
+		edges1_3.push_back(edge1_3);
+		normals.push_back(glm::normalize(glm::cross(edge1_2, edge1_3)));
+
+		AABB bounds;
+		bounds.expand(vertex1);
+		bounds.expand(vertex2);
+		bounds.expand(vertex3);
+		triangle_bounds.push_back(bounds);
+	}
+
+	this->bvh = BVH(triangle_bounds);
+
+	const SharedArray<uint32_t>& order = this->bvh.getPrimitiveIndices();
+	this->vertices1 = reorder(vertices1, order);
+	this->edges1_2 = reorder(edges1_2, order);
+	this->edges1_3 = reorder(edges1_3, order);
+	this->normals = reorder(normals, order);
+	this->bvh.markPrimitivesReordered();
+}
+
+TriangleMesh::TriangleMesh(
+	const SharedArray<glm::vec3>& vertices1,
+	const SharedArray<glm::vec3>& edges1_2,
+	const SharedArray<glm::vec3>& edges1_3,
+	const SharedArray<glm::vec3>& normals,
+	const BVH& bvh
+) : vertices1(vertices1),
+    edges1_2(edges1_2),
+    edges1_3(edges1_3),
+    normals(normals),
+    bvh(bvh)
+{
+	size_t triangle_count = vertices1.size();
+	if (
+		edges1_2.size() != triangle_count ||
+		edges1_3.size() != triangle_count ||
+		normals.size() != triangle_count ||
+		bvh.getPrimitiveIndices().size() != triangle_count
+	) {
+		throw std::runtime_error("Triangle arrays must all be the same length.");
+	}
+}
+
+size_t TriangleMesh::getTriangleCount() const
+{
+	return this->vertices1.size();
+}
+
+size_t TriangleMesh::getMemoryUsage() const
+{
+	return
+		this->vertices1.size() * sizeof(glm::vec3) +
+		this->edges1_2.size() * sizeof(glm::vec3) +
+		this->edges1_3.size() * sizeof(glm::vec3) +
+		this->normals.size() * sizeof(glm::vec3) +
+		this->bvh.getNodes().size() * sizeof(BVHNode) +
+		this->bvh.getPrimitiveIndices().size() * sizeof(uint32_t);
+}
+
+const SharedArray<glm::vec3>& TriangleMesh::getVertices1() const
+{
+	return this->vertices1;
+}
+
+const SharedArray<glm::vec3>& TriangleMesh::getEdges1_2() const
+{
+	return this->edges1_2;
+}
+
+const SharedArray<glm::vec3>& TriangleMesh::getEdges1_3() const
+{
+	return this->edges1_3;
+}
+
+const SharedArray<glm::vec3>& TriangleMesh::getNormals() const
+{
+	return this->normals;
+}
+
+const BVH& TriangleMesh::getBVH() const
+{
+	return this->bvh;
+}
+
+AABB TriangleMesh::getBounds() const
+{
+	return this->bvh.getBounds();
+}
+
+bool TriangleMesh::doesRayIntersect(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float* const& t,
+	glm::vec3* const& normal
+) const
+{
+	uint32_t triangle_index;
+	glm::vec2 barycentric;
+	if (!this->doesRayIntersect(origin, direction, t, &triangle_index, &barycentric)) {
+		return false;
+	}
+	*normal = this->normals[triangle_index];
+	return true;
+}
+
+bool TriangleMesh::doesRayIntersect(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float* const& t,
+	uint32_t* const& triangle_index,
+	glm::vec2* const& barycentric
+) const
+{
+	*t = std::numeric_limits<float>::max();
+
+	float temp_t, u, v;
+	// find nearest intersection point among triangles
+	return this->bvh.intersect(
+		origin,
+		direction,
+		t,
+		[&](uint32_t index, float* const& closest_t) {
+			if (
+				doesRayIntersectTriangle(
+					origin,
+					direction,
+					this->vertices1[index],
+					this->edges1_2[index],
+					this->edges1_3[index],
+					&temp_t,
+					&u,
+					&v
+				) &&
+				temp_t < *closest_t
+			) {
+				*closest_t = temp_t;
+				*triangle_index = index;
+				*barycentric = glm::vec2(u, v);
+				return true;
+			}
+			return false;
+		}
+	);
+}
+
+glm::vec3 TriangleMesh::getNormal(const uint32_t& triangle_index) const
+{
+	return this->normals[triangle_index];
+}
+
+unsigned int TriangleMesh::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	return this->bvh.intersectPacket(
+		packet,
+		kernels,
+		[&](uint32_t triangle_index) {
+			PROFILE_COUNT(triangle_tests, 1);
+			unsigned int mask = kernels.intersectTriangle(
+				packet,
+				this->vertices1[triangle_index],
+				this->edges1_2[triangle_index],
+				this->edges1_3[triangle_index]
+			);
+			for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+				if (mask & (1u << lane)) {
+					packet->normals[lane] = this->normals[triangle_index];
+				}
+			}
+			return mask;
+		}
+	);
+}
+
+bool TriangleMesh::isBlockingRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max
+) const
+{
+	float t, u, v;
+	return this->bvh.isOccluded(
+		origin,
+		direction,
+		t_max,
+		[&](uint32_t triangle_index) {
+			return doesRayIntersectTriangle(
+				origin,
+				direction,
+				this->vertices1[triangle_index],
+				this->edges1_2[triangle_index],
+				this->edges1_3[triangle_index],
+				&t,
+				&u,
+				&v
+			) && t < t_max;
+		}
+	);
+}
@@ -0,0 +1,89 @@
+#ifndef RAYTRACER_TRIANGLEMESH_HPP
+#define RAYTRACER_TRIANGLEMESH_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AABB.hpp"
+#include "BVH.hpp"
+#include "SharedArray.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+
+// Triangle soup stored as a structure of arrays, with everything the intersection
+// test needs precomputed per triangle. Arrays are kept in BVH leaf order, so the
+// triangles tested at a leaf occupy neighbouring entries of each array rather than
+// being scattered across the heap as separate objects. The arrays can also be
+// mapped straight from a MeshCache file, rather than built.
+
+class TriangleMesh {
+private:
+	// first vertex of each triangle
+	SharedArray<glm::vec3> vertices1;
+	// vertex2 - vertex1 and vertex3 - vertex1
+	SharedArray<glm::vec3> edges1_2;
+	SharedArray<glm::vec3> edges1_3;
+	// only read once the closest hit is known
+	SharedArray<glm::vec3> normals;
+	BVH bvh;
+public:
+	TriangleMesh() = default;
+	// each consecutive three entries in triangle_indices index the vertices of
+	// one triangle
+	TriangleMesh(
+		const std::vector<glm::vec3>& vertices,
+		const std::vector<uint32_t>& triangle_indices
+	);
+	// a mesh built earlier (see MeshCache), from its arrays in BVH leaf order
+	TriangleMesh(
+		const SharedArray<glm::vec3>& vertices1,
+		const SharedArray<glm::vec3>& edges1_2,
+		const SharedArray<glm::vec3>& edges1_3,
+		const SharedArray<glm::vec3>& normals,
+		const BVH& bvh
+	);
+	size_t getTriangleCount() const;
+	// bytes held by triangle data and BVH
+	size_t getMemoryUsage() const;
+	const SharedArray<glm::vec3>& getVertices1() const;
+	const SharedArray<glm::vec3>& getEdges1_2() const;
+	const SharedArray<glm::vec3>& getEdges1_3() const;
+	const SharedArray<glm::vec3>& getNormals() const;
+	const BVH& getBVH() const;
+	AABB getBounds() const;
+	// if return is true, *t is set to value of t in
+	// ray parametric equation: p(t) = origin + direction * t
+	bool doesRayIntersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float* const& t,
+		glm::vec3* const& normal
+	) const;
+	// ...and this version also gives the index of the triangle hit (in this mesh's
+	// storage order) and the barycentric coordinates of the hit on it (see
+	// doesRayIntersectTriangle)
+	bool doesRayIntersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float* const& t,
+		uint32_t* const& triangle_index,
+		glm::vec2* const& barycentric
+	) const;
+	glm::vec3 getNormal(const uint32_t& triangle_index) const;
+	// updates closest hit t and normal of lanes hitting a triangle closer than their
+	// closest hit so far, returning a mask of those lanes
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const;
+	bool isBlockingRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) const;
+};
+
+
+#endif //RAYTRACER_TRIANGLEMESH_HPP
@@ -0,0 +1,58 @@
+#ifndef RAYTRACER_DOESRAYINTERSECTTRIANGLE_HPP
+#define RAYTRACER_DOESRAYINTERSECTTRIANGLE_HPP
+
+#include <glm/glm.hpp>
+
+#include <src/constants.hpp>
+#include <src/profiling/Profiler.hpp>
+
+// Möller-Trumbore ray-triangle intersection, as described in:
+// Tomas Möller and Ben Trumbore, "Fast, Minimum Storage Ray-Triangle Intersection",
+// Journal of Graphics Tools 2(1), 1997.
+//
+// The triangle is given by its first vertex and the edges from it to the other two,
+// which callers precompute once rather than per test. Both sides of the triangle
+// count as hits, and points exactly on an edge are inside.
+//
+// If return is true, *t is set to value of t in ray parametric equation:
+// p(t) = origin + direction * t
+// and *u, *v to the barycentric coordinates of p(t), i.e.
+// p(t) = vertex1 + edge1_2 * *u + edge1_3 * *v
+// (so weights of vertex1, vertex2 and vertex3 are 1 - *u - *v, *u and *v).
+// (defined inline since it sits on the hot path of BVH traversal)
+
+inline bool doesRayIntersectTriangle(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const glm::vec3& vertex1,
+	const glm::vec3& edge1_2,
+	const glm::vec3& edge1_3,
+	float* const& t,
+	float* const& u,
+	float* const& v
+) {
+	PROFILE_COUNT(triangle_tests, 1);
+
+	glm::vec3 direction_cross_edge1_3 = glm::cross(direction, edge1_3);
+	// zero if ray is parallel to the triangle, in which case everything below
+	// comes out infinite or NaN, and the comparisons are written to fail for those
+	float inverse_determinant = 1.0f / glm::dot(edge1_2, direction_cross_edge1_3);
+
+	glm::vec3 vertex1_to_origin = origin - vertex1;
+	*u = glm::dot(vertex1_to_origin, direction_cross_edge1_3) * inverse_determinant;
+	if (!(*u >= 0.0f && *u <= 1.0f)) {
+		return false;
+	}
+
+	glm::vec3 vertex1_to_origin_cross_edge1_2 = glm::cross(vertex1_to_origin, edge1_2);
+	*v = glm::dot(direction, vertex1_to_origin_cross_edge1_2) * inverse_determinant;
+	if (!(*v >= 0.0f && *u + *v <= 1.0f)) {
+		return false;
+	}
+
+	*t = glm::dot(edge1_3, vertex1_to_origin_cross_edge1_2) * inverse_determinant;
+	return *t >= t_threshold;
+}
+
+
+#endif //RAYTRACER_DOESRAYINTERSECTTRIANGLE_HPP
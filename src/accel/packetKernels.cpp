@@ -0,0 +1,85 @@
+#include <glm/glm.hpp>
+#include <string>
+#include <cmath>
+
+#include "AABB.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+#include "packetKernelsImpl.hpp"
+
+// defined in packetKernelsSSE.cpp and packetKernelsAVX2.cpp; nullptr if the
+// compiler couldn't target that instruction set
+extern const PacketKernels* const sse_packet_kernels;
+extern const PacketKernels* const avx2_packet_kernels;
+
+namespace {
+	// one lane per "register", so runs anywhere
+	struct ScalarLanes {
+		static const unsigned int width = 1;
+		typedef float Value;
+		typedef bool Mask;
+
+		static Value load(const float* const& p) { return *p; }
+		static void store(float* const& p, const Value& v) { *p = v; }
+		static Value broadcast(const float& f) { return f; }
+		static Value add(const Value& a, const Value& b) { return a + b; }
+		static Value sub(const Value& a, const Value& b) { return a - b; }
+		static Value mul(const Value& a, const Value& b) { return a * b; }
+		static Value div(const Value& a, const Value& b) { return a / b; }
+		static Value sqrt(const Value& a) { return std::sqrt(a); }
+		static Mask less(const Value& a, const Value& b) { return a < b; }
+		static Mask lessEqual(const Value& a, const Value& b) { return a <= b; }
+		static Mask greater(const Value& a, const Value& b) { return a > b; }
+		static Mask greaterEqual(const Value& a, const Value& b) { return a >= b; }
+		static Mask notLess(const Value& a, const Value& b) { return !(a < b); }
+		static Mask notGreater(const Value& a, const Value& b) { return !(a > b); }
+		static Mask maskAnd(const Mask& a, const Mask& b) { return a && b; }
+		static Value select(const Mask& m, const Value& a, const Value& b)
+		{
+			return m ? a : b;
+		}
+		static unsigned int movemask(const Mask& m) { return m ? 1u : 0u; }
+	};
+
+	const PacketKernels scalar_packet_kernels = {
+		"scalar",
+		ScalarLanes::width,
+		&packet::intersectBox<ScalarLanes>,
+		&packet::intersectSphere<ScalarLanes>,
+		&packet::intersectPlane<ScalarLanes>,
+		&packet::intersectTriangle<ScalarLanes>
+	};
+
+	bool isAVX2Supported()
+	{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+}
+
+const PacketKernels& getPacketKernels()
+{
+	static const PacketKernels* kernels =
+		getPacketKernels("avx2") ? getPacketKernels("avx2") :
+		getPacketKernels("sse") ? getPacketKernels("sse") :
+		&scalar_packet_kernels;
+	return *kernels;
+}
+
+const PacketKernels* getPacketKernels(const std::string& name)
+{
+	if (name == "avx2") {
+		return isAVX2Supported() ? avx2_packet_kernels : nullptr;
+	}
+	if (name == "sse") {
+		// SSE2 is part of the x86-64 baseline, so if it was compiled in it's there
+		return sse_packet_kernels;
+	}
+	if (name == "scalar") {
+		return &scalar_packet_kernels;
+	}
+	return nullptr;
+}
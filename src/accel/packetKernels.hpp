@@ -0,0 +1,54 @@
+#ifndef RAYTRACER_PACKETKERNELS_HPP
+#define RAYTRACER_PACKETKERNELS_HPP
+
+#include <glm/glm.hpp>
+#include <string>
+
+#include "AABB.hpp"
+#include "RayPacket.hpp"
+
+// Intersection tests between every ray of a RayPacket and one primitive, written
+// once (packetKernelsImpl.hpp) against a small set of SIMD operations and compiled
+// for each instruction set in its own translation unit, so that AVX2 code is only
+// ever run on CPUs that support it.
+//
+// Each kernel mirrors the arithmetic of the matching scalar test, so a packet finds
+// the same hits as tracing its rays one at a time.
+
+struct PacketKernels {
+	const char* name;
+	// rays processed per instruction
+	unsigned int lane_width;
+	// mask of lanes whose ray enters the box before its closest hit so far
+	unsigned int (*intersectBox)(const RayPacket& packet, const AABB& box);
+	// The rest update packet->t for lanes where the primitive is hit closer than
+	// packet->t already is, returning a mask of those lanes. Filling in the hit's
+	// normal and object is left to the caller.
+	unsigned int (*intersectSphere)(
+		RayPacket* const& packet,
+		const glm::vec3& center,
+		const float& radius
+	);
+	// plane_distance is dot(normal, any point on the plane)
+	unsigned int (*intersectPlane)(
+		RayPacket* const& packet,
+		const glm::vec3& normal,
+		const float& plane_distance
+	);
+	// triangle given as for doesRayIntersectTriangle
+	unsigned int (*intersectTriangle)(
+		RayPacket* const& packet,
+		const glm::vec3& vertex1,
+		const glm::vec3& edge1_2,
+		const glm::vec3& edge1_3
+	);
+};
+
+// widest kernels the running CPU supports
+const PacketKernels& getPacketKernels();
+// kernels for the named instruction set ("avx2", "sse" or "scalar"), or nullptr if
+// it wasn't compiled in or the running CPU doesn't support it
+const PacketKernels* getPacketKernels(const std::string& name);
+
+
+#endif //RAYTRACER_PACKETKERNELS_HPP
@@ -0,0 +1,100 @@
+// Only the kernels below are compiled for AVX2, by way of target pragmas rather than
+// building the whole file with -mavx2. That keeps any inline functions from the
+// headers above (and static initializers, which run before the CPU is checked) free
+// of AVX2 instructions, as the linker may pick this file's copy of them for
+// everyone.
+
+#include <glm/glm.hpp>
+#include <limits>
+
+#include <src/constants.hpp>
+
+#include "AABB.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "packetKernelsImpl.hpp"
+
+namespace {
+	struct AVX2Lanes {
+		static const unsigned int width = 8;
+		typedef __m256 Value;
+		typedef __m256 Mask;
+
+		static Value load(const float* const& p) { return _mm256_loadu_ps(p); }
+		static void store(float* const& p, const Value& v) { _mm256_storeu_ps(p, v); }
+		static Value broadcast(const float& f) { return _mm256_set1_ps(f); }
+		static Value add(const Value& a, const Value& b) { return _mm256_add_ps(a, b); }
+		static Value sub(const Value& a, const Value& b) { return _mm256_sub_ps(a, b); }
+		static Value mul(const Value& a, const Value& b) { return _mm256_mul_ps(a, b); }
+		static Value div(const Value& a, const Value& b) { return _mm256_div_ps(a, b); }
+		static Value sqrt(const Value& a) { return _mm256_sqrt_ps(a); }
+		static Mask less(const Value& a, const Value& b)
+		{
+			return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+		}
+		static Mask lessEqual(const Value& a, const Value& b)
+		{
+			return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+		}
+		static Mask greater(const Value& a, const Value& b)
+		{
+			return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+		}
+		static Mask greaterEqual(const Value& a, const Value& b)
+		{
+			return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+		}
+		static Mask notLess(const Value& a, const Value& b)
+		{
+			return _mm256_cmp_ps(a, b, _CMP_NLT_UQ);
+		}
+		static Mask notGreater(const Value& a, const Value& b)
+		{
+			return _mm256_cmp_ps(a, b, _CMP_NGT_UQ);
+		}
+		static Mask maskAnd(const Mask& a, const Mask& b) { return _mm256_and_ps(a, b); }
+		static Value select(const Mask& m, const Value& a, const Value& b)
+		{
+			return _mm256_blendv_ps(b, a, m);
+		}
+		static unsigned int movemask(const Mask& m)
+		{
+			return (unsigned int)_mm256_movemask_ps(m);
+		}
+	};
+
+	const PacketKernels avx2_kernels = {
+		"avx2",
+		AVX2Lanes::width,
+		&packet::intersectBox<AVX2Lanes>,
+		&packet::intersectSphere<AVX2Lanes>,
+		&packet::intersectPlane<AVX2Lanes>,
+		&packet::intersectTriangle<AVX2Lanes>
+	};
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+extern const PacketKernels* const avx2_packet_kernels = &avx2_kernels;
+
+#else
+
+extern const PacketKernels* const avx2_packet_kernels = nullptr;
+
+#endif
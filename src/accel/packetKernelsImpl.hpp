@@ -0,0 +1,296 @@
+#ifndef RAYTRACER_PACKETKERNELSIMPL_HPP
+#define RAYTRACER_PACKETKERNELSIMPL_HPP
+
+#include <glm/glm.hpp>
+#include <limits>
+
+#include <src/constants.hpp>
+
+#include "AABB.hpp"
+#include "RayPacket.hpp"
+#include "packetKernels.hpp"
+
+// Packet kernel bodies, shared by every instruction set. Only included by the
+// packetKernels*.cpp files, each of which instantiates them with its own Lanes
+// type, providing:
+//
+// * width: number of floats per Value
+// * Value, Mask: a register of floats, and the result of comparing two
+// * load, store, broadcast
+// * add, sub, mul, div, sqrt
+// * less, lessEqual, greater, greaterEqual, notLess, notGreater: comparisons, where
+//   only the not* variants are true for NaNs (matching scalar code that rejects on
+//   a < b, rather than accepting on a >= b)
+// * maskAnd, select(mask, if_true, if_false), movemask (one bit per float)
+//
+// Every kernel is written to do the same floating point operations, in the same
+// order, as the scalar test it mirrors.
+
+namespace packet {
+	template <typename L>
+	typename L::Value dot(
+		const typename L::Value& a_x,
+		const typename L::Value& a_y,
+		const typename L::Value& a_z,
+		const typename L::Value& b_x,
+		const typename L::Value& b_y,
+		const typename L::Value& b_z
+	) {
+		return L::add(L::add(L::mul(a_x, b_x), L::mul(a_y, b_y)), L::mul(a_z, b_z));
+	}
+
+	template <typename L>
+	void cross(
+		const typename L::Value& a_x,
+		const typename L::Value& a_y,
+		const typename L::Value& a_z,
+		const typename L::Value& b_x,
+		const typename L::Value& b_y,
+		const typename L::Value& b_z,
+		typename L::Value* const& cross_x,
+		typename L::Value* const& cross_y,
+		typename L::Value* const& cross_z
+	) {
+		*cross_x = L::sub(L::mul(a_y, b_z), L::mul(b_y, a_z));
+		*cross_y = L::sub(L::mul(a_z, b_x), L::mul(b_z, a_x));
+		*cross_z = L::sub(L::mul(a_x, b_y), L::mul(b_x, a_y));
+	}
+
+	// see AABB::doesRayIntersect
+	template <typename L>
+	unsigned int intersectBox(const RayPacket& packet, const AABB& box)
+	{
+		typedef typename L::Value Value;
+		typedef typename L::Mask Mask;
+
+		const float* origins[3] = {packet.origin_x, packet.origin_y, packet.origin_z};
+		const float* inverse_directions[3] = {
+			packet.inverse_direction_x,
+			packet.inverse_direction_y,
+			packet.inverse_direction_z
+		};
+		Value widening =
+			L::broadcast(1.0f + 2.0f * 3.0f * std::numeric_limits<float>::epsilon());
+
+		unsigned int mask = 0;
+		for (unsigned int i = 0; i < RayPacket::size; i += L::width) {
+			Value t0 = L::broadcast(0.0f);
+			Value t1 = L::load(packet.t + i);
+			for (int axis = 0; axis < 3; axis++) {
+				Value origin = L::load(origins[axis] + i);
+				Value inverse_direction = L::load(inverse_directions[axis] + i);
+				Value t_a =
+					L::mul(L::sub(L::broadcast(box.min[axis]), origin), inverse_direction);
+				Value t_b =
+					L::mul(L::sub(L::broadcast(box.max[axis]), origin), inverse_direction);
+				Mask swap = L::greater(t_a, t_b);
+				Value t_near = L::select(swap, t_b, t_a);
+				Value t_far = L::mul(L::select(swap, t_a, t_b), widening);
+				t0 = L::select(L::greater(t_near, t0), t_near, t0);
+				t1 = L::select(L::less(t_far, t1), t_far, t1);
+			}
+			mask |= L::movemask(L::notGreater(t0, t1)) << i;
+		}
+		return mask;
+	}
+
+	// see Sphere::doesRayIntersect
+	template <typename L>
+	unsigned int intersectSphere(
+		RayPacket* const& packet,
+		const glm::vec3& center,
+		const float& radius
+	) {
+		typedef typename L::Value Value;
+		typedef typename L::Mask Mask;
+
+		Value radius_squared = L::broadcast(radius * radius);
+
+		unsigned int mask = 0;
+		for (unsigned int i = 0; i < RayPacket::size; i += L::width) {
+			Value direction_x = L::load(packet->direction_x + i);
+			Value direction_y = L::load(packet->direction_y + i);
+			Value direction_z = L::load(packet->direction_z + i);
+			Value to_center_x =
+				L::sub(L::broadcast(center.x), L::load(packet->origin_x + i));
+			Value to_center_y =
+				L::sub(L::broadcast(center.y), L::load(packet->origin_y + i));
+			Value to_center_z =
+				L::sub(L::broadcast(center.z), L::load(packet->origin_z + i));
+			Value t_center_axis = dot<L>(
+				to_center_x,
+				to_center_y,
+				to_center_z,
+				direction_x,
+				direction_y,
+				direction_z
+			);
+			// (a ray starting inside the sphere always hits its far side)
+			Value to_center_squared = dot<L>(
+				to_center_x,
+				to_center_y,
+				to_center_z,
+				to_center_x,
+				to_center_y,
+				to_center_z
+			);
+			Mask is_origin_inside = L::less(to_center_squared, radius_squared);
+			Mask hit = L::notLess(
+				L::select(is_origin_inside, L::broadcast(t_threshold), t_center_axis),
+				L::broadcast(t_threshold)
+			);
+
+			Value center_to_ray_x = L::sub(to_center_x, L::mul(direction_x, t_center_axis));
+			Value center_to_ray_y = L::sub(to_center_y, L::mul(direction_y, t_center_axis));
+			Value center_to_ray_z = L::sub(to_center_z, L::mul(direction_z, t_center_axis));
+			Value d_squared = dot<L>(
+				center_to_ray_x,
+				center_to_ray_y,
+				center_to_ray_z,
+				center_to_ray_x,
+				center_to_ray_y,
+				center_to_ray_z
+			);
+			hit = L::maskAnd(hit, L::notGreater(d_squared, radius_squared));
+
+			Value t_from_point_to_center_axis = L::sqrt(L::sub(radius_squared, d_squared));
+			// the near intersection, unless it's behind the origin
+			Value t_near = L::sub(t_center_axis, t_from_point_to_center_axis);
+			Value t = L::select(
+				L::greaterEqual(t_near, L::broadcast(t_threshold)),
+				t_near,
+				L::add(t_center_axis, t_from_point_to_center_axis)
+			);
+			Value closest_t = L::load(packet->t + i);
+			hit = L::maskAnd(hit, L::less(t, closest_t));
+			L::store(packet->t + i, L::select(hit, t, closest_t));
+			mask |= L::movemask(hit) << i;
+		}
+		return mask;
+	}
+
+	// see Plane::doesRayIntersect
+	template <typename L>
+	unsigned int intersectPlane(
+		RayPacket* const& packet,
+		const glm::vec3& normal,
+		const float& plane_distance
+	) {
+		typedef typename L::Value Value;
+		typedef typename L::Mask Mask;
+
+		Value normal_x = L::broadcast(normal.x);
+		Value normal_y = L::broadcast(normal.y);
+		Value normal_z = L::broadcast(normal.z);
+
+		unsigned int mask = 0;
+		for (unsigned int i = 0; i < RayPacket::size; i += L::width) {
+			Value normal_dot_origin = dot<L>(
+				normal_x,
+				normal_y,
+				normal_z,
+				L::load(packet->origin_x + i),
+				L::load(packet->origin_y + i),
+				L::load(packet->origin_z + i)
+			);
+			Value normal_dot_direction = dot<L>(
+				normal_x,
+				normal_y,
+				normal_z,
+				L::load(packet->direction_x + i),
+				L::load(packet->direction_y + i),
+				L::load(packet->direction_z + i)
+			);
+			Value t = L::div(
+				L::sub(L::broadcast(plane_distance), normal_dot_origin),
+				normal_dot_direction
+			);
+			Value closest_t = L::load(packet->t + i);
+			// (ordered comparison, so false for NaN)
+			Mask hit = L::maskAnd(
+				L::greaterEqual(t, L::broadcast(t_threshold)),
+				L::less(t, closest_t)
+			);
+			L::store(packet->t + i, L::select(hit, t, closest_t));
+			mask |= L::movemask(hit) << i;
+		}
+		return mask;
+	}
+
+	// see doesRayIntersectTriangle
+	template <typename L>
+	unsigned int intersectTriangle(
+		RayPacket* const& packet,
+		const glm::vec3& vertex1,
+		const glm::vec3& edge1_2,
+		const glm::vec3& edge1_3
+	) {
+		typedef typename L::Value Value;
+		typedef typename L::Mask Mask;
+
+		Value edge1_2_x = L::broadcast(edge1_2.x);
+		Value edge1_2_y = L::broadcast(edge1_2.y);
+		Value edge1_2_z = L::broadcast(edge1_2.z);
+		Value edge1_3_x = L::broadcast(edge1_3.x);
+		Value edge1_3_y = L::broadcast(edge1_3.y);
+		Value edge1_3_z = L::broadcast(edge1_3.z);
+		Value zero = L::broadcast(0.0f);
+		Value one = L::broadcast(1.0f);
+
+		unsigned int mask = 0;
+		for (unsigned int i = 0; i < RayPacket::size; i += L::width) {
+			Value direction_x = L::load(packet->direction_x + i);
+			Value direction_y = L::load(packet->direction_y + i);
+			Value direction_z = L::load(packet->direction_z + i);
+
+			Value p_x, p_y, p_z;
+			cross<L>(
+				direction_x,
+				direction_y,
+				direction_z,
+				edge1_3_x,
+				edge1_3_y,
+				edge1_3_z,
+				&p_x,
+				&p_y,
+				&p_z
+			);
+			Value inverse_determinant = L::div(
+				one,
+				dot<L>(edge1_2_x, edge1_2_y, edge1_2_z, p_x, p_y, p_z)
+			);
+
+			Value s_x = L::sub(L::load(packet->origin_x + i), L::broadcast(vertex1.x));
+			Value s_y = L::sub(L::load(packet->origin_y + i), L::broadcast(vertex1.y));
+			Value s_z = L::sub(L::load(packet->origin_z + i), L::broadcast(vertex1.z));
+			Value u = L::mul(dot<L>(s_x, s_y, s_z, p_x, p_y, p_z), inverse_determinant);
+			// (ordered comparisons, so false for the NaNs and infinities a ray
+			// parallel to the triangle produces)
+			Mask hit = L::maskAnd(L::greaterEqual(u, zero), L::lessEqual(u, one));
+
+			Value q_x, q_y, q_z;
+			cross<L>(s_x, s_y, s_z, edge1_2_x, edge1_2_y, edge1_2_z, &q_x, &q_y, &q_z);
+			Value v = L::mul(
+				dot<L>(direction_x, direction_y, direction_z, q_x, q_y, q_z),
+				inverse_determinant
+			);
+			hit = L::maskAnd(hit, L::greaterEqual(v, zero));
+			hit = L::maskAnd(hit, L::lessEqual(L::add(u, v), one));
+
+			Value t = L::mul(
+				dot<L>(edge1_3_x, edge1_3_y, edge1_3_z, q_x, q_y, q_z),
+				inverse_determinant
+			);
+			hit = L::maskAnd(hit, L::greaterEqual(t, L::broadcast(t_threshold)));
+
+			Value closest_t = L::load(packet->t + i);
+			hit = L::maskAnd(hit, L::less(t, closest_t));
+			L::store(packet->t + i, L::select(hit, t, closest_t));
+			mask |= L::movemask(hit) << i;
+		}
+		return mask;
+	}
+}
+
+
+#endif //RAYTRACER_PACKETKERNELSIMPL_HPP
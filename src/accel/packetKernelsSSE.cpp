@@ -0,0 +1,63 @@
+#include "packetKernels.hpp"
+
+#ifdef __SSE2__
+
+#include <emmintrin.h>
+
+#include "packetKernelsImpl.hpp"
+
+namespace {
+	struct SSELanes {
+		static const unsigned int width = 4;
+		typedef __m128 Value;
+		typedef __m128 Mask;
+
+		static Value load(const float* const& p) { return _mm_loadu_ps(p); }
+		static void store(float* const& p, const Value& v) { _mm_storeu_ps(p, v); }
+		static Value broadcast(const float& f) { return _mm_set1_ps(f); }
+		static Value add(const Value& a, const Value& b) { return _mm_add_ps(a, b); }
+		static Value sub(const Value& a, const Value& b) { return _mm_sub_ps(a, b); }
+		static Value mul(const Value& a, const Value& b) { return _mm_mul_ps(a, b); }
+		static Value div(const Value& a, const Value& b) { return _mm_div_ps(a, b); }
+		static Value sqrt(const Value& a) { return _mm_sqrt_ps(a); }
+		static Mask less(const Value& a, const Value& b) { return _mm_cmplt_ps(a, b); }
+		static Mask lessEqual(const Value& a, const Value& b) { return _mm_cmple_ps(a, b); }
+		static Mask greater(const Value& a, const Value& b) { return _mm_cmpgt_ps(a, b); }
+		static Mask greaterEqual(const Value& a, const Value& b)
+		{
+			return _mm_cmpge_ps(a, b);
+		}
+		static Mask notLess(const Value& a, const Value& b) { return _mm_cmpnlt_ps(a, b); }
+		static Mask notGreater(const Value& a, const Value& b)
+		{
+			return _mm_cmpngt_ps(a, b);
+		}
+		static Mask maskAnd(const Mask& a, const Mask& b) { return _mm_and_ps(a, b); }
+		static Value select(const Mask& m, const Value& a, const Value& b)
+		{
+			// (no blendv before SSE4.1)
+			return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+		}
+		static unsigned int movemask(const Mask& m)
+		{
+			return (unsigned int)_mm_movemask_ps(m);
+		}
+	};
+
+	const PacketKernels sse_kernels = {
+		"sse",
+		SSELanes::width,
+		&packet::intersectBox<SSELanes>,
+		&packet::intersectSphere<SSELanes>,
+		&packet::intersectPlane<SSELanes>,
+		&packet::intersectTriangle<SSELanes>
+	};
+}
+
+extern const PacketKernels* const sse_packet_kernels = &sse_kernels;
+
+#else
+
+extern const PacketKernels* const sse_packet_kernels = nullptr;
+
+#endif
@@ -0,0 +1,898 @@
+#include <glm/glm.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <sys/resource.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+#include "entities/Camera.hpp"
+#include "entities/Light.hpp"
+#include "entities/objects/Object3D.hpp"
+#include "entities/objects/ObjModel.hpp"
+#include "entities/objects/Sphere.hpp"
+#include "accel/AABB.hpp"
+#include "accel/BVH.hpp"
+#include "accel/SceneBVH.hpp"
+#include "accel/packetKernels.hpp"
+#include "accel/TriangleMesh.hpp"
+#include "accel/doesRayIntersectTriangle.hpp"
+#include "render/Renderer.hpp"
+#include "render/SampleRandom.hpp"
+#include "loadScene.hpp"
+#include "profiling/Profiler.hpp"
+#include "parseCommandLine.hpp"
+#include "getColorForRay.hpp"
+#include "constants.hpp"
+
+namespace fs = boost::filesystem;
+
+// Renders every scene in the scenes directory, plus a couple of synthetic stress
+// scenes, several times each without showing or saving anything, and writes how
+// long it all took as JSON. Like raytracer, it's run from the bin/ directory.
+// With --verify-shadows it instead checks the scene BVH's shadow tests against a
+// brute-force reference (see verifyShadows), and with --triangle-kernel it times
+// ray-triangle tests on their own (see runTriangleKernelBenchmark).
+
+struct BenchmarkOptions {
+	size_t repetitions = 3;
+	// 0 means one per hardware thread
+	size_t thread_count = 0;
+	std::string simd = "auto";
+	// empty to write to standard output
+	std::string output_filename;
+	bool include_stress_scenes = true;
+	// where to write a Chrome trace, if not empty (see Profiler)
+	std::string profile_filename;
+	bool verify_shadows = false;
+	bool time_triangle_kernel = false;
+	bool show_help = false;
+};
+
+// a scene ready to render, which owns its objects
+struct BenchmarkScene {
+	std::string name;
+	Camera camera;
+	std::vector<Light> lights;
+	std::vector<Object3D*> objects;
+	// to read the scene (and any models it has) into memory, not counting its BVH
+	double load_milliseconds = 0.0;
+
+	BenchmarkScene() = default;
+	BenchmarkScene(const BenchmarkScene&) = delete;
+	BenchmarkScene& operator=(const BenchmarkScene&) = delete;
+	~BenchmarkScene()
+	{
+		for (Object3D* object : this->objects) {
+			delete object;
+		}
+	}
+};
+
+// random triangles, stored as TriangleMesh stores them, each paired with a ray
+// aimed at a random point of its bounding box (as rays tested against the
+// triangles of a BVH leaf are aimed at the leaf's box)
+struct TriangleKernelInput {
+	std::vector<glm::vec3> vertices1;
+	std::vector<glm::vec3> edges1_2;
+	std::vector<glm::vec3> edges1_3;
+	std::vector<glm::vec3> normals;
+	// dot(normal, vertex1), only read by doesRayIntersectTrianglePlane
+	std::vector<float> plane_distances;
+	std::vector<glm::vec3> origins;
+	std::vector<glm::vec3> directions;
+};
+
+// throws std::runtime_error describing the problem if arguments are invalid
+BenchmarkOptions parseBenchmarkOptions(int argc, char** argv);
+
+std::string getBenchmarkUsage(const std::string& program_name);
+
+std::vector<std::string> getSceneFilenames();
+
+// throws whatever loadScene does if the scene can't be loaded
+void loadSceneFile(const std::string& filename, BenchmarkScene* const& scene);
+
+// side x side x side spheres, filling the view
+void makeSphereGridScene(const unsigned int& side, BenchmarkScene* const& scene);
+
+// map.obj (a stretch of terrain), looked down on from one side at 3840 x 2160
+void makeMapScene(BenchmarkScene* const& scene);
+
+// renders scene options.repetitions times and writes its results as a JSON object
+void runBenchmark(
+	const BenchmarkScene& scene,
+	const BenchmarkOptions& options,
+	const PacketKernels* const& packet_kernels,
+	std::ostream* const& json
+);
+
+// Traces a primary ray through the center of each pixel of scene and, from every
+// hit, a shadow ray to each sample point of each light, placed the way shading
+// places them. Each shadow ray is tested with SceneBVH::isBlockingSegment, and (if
+// packet_kernels isn't null) in packets with SceneBVH::occludePacket, and the
+// results compared with a closest-hit loop over every object in the scene.
+// Prints the first few mismatches and a summary line to standard error, and
+// returns the number of shadow rays that didn't match.
+size_t verifyShadows(
+	const BenchmarkScene& scene,
+	const PacketKernels* const& packet_kernels
+);
+
+// count triangles scattered over the unit cube, with sides of up to a tenth of it,
+// and their rays, each starting from a random point on a sphere around the cube
+void makeTriangleKernelInput(const size_t& count, TriangleKernelInput* const& input);
+
+// The triangle test doesRayIntersectTriangle (Möller-Trumbore) replaced, kept as
+// the baseline for --triangle-kernel: intersects the triangle's plane, then checks
+// the point hit is on the inner side of each of its edges. Sets *t the same way.
+bool doesRayIntersectTrianglePlane(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const glm::vec3& vertex1,
+	const glm::vec3& edge1_2,
+	const glm::vec3& edge1_3,
+	const glm::vec3& normal,
+	const float& plane_distance,
+	float* const& t
+);
+
+// Tests the rays of a TriangleKernelInput against their triangles with each
+// triangle test, options.repetitions times over, and writes the nanoseconds each
+// test took (in the fastest repetition) and how many hit as JSON
+void runTriangleKernelBenchmark(
+	const BenchmarkOptions& options,
+	std::ostream* const& json
+);
+
+// Calls test(i, &t) for each pair i of input, passes times over, and returns the
+// nanoseconds taken per call. *hit_count is set to the number of calls per pass
+// that returned true.
+template <typename Test>
+double timeTriangleTests(
+	const TriangleKernelInput& input,
+	const size_t& passes,
+	Test test,
+	size_t* const& hit_count
+);
+
+// resets the peak resident set size so the next one read is the peak since now.
+// Returns false if the platform doesn't allow it, in which case peaks are over the
+// whole run so far.
+bool resetPeakResidentMemory();
+
+// in KiB
+size_t getPeakResidentMemory();
+
+std::string toJsonString(const std::string& value);
+
+double millisecondsSince(const std::chrono::steady_clock::time_point& start);
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	try {
+		options = parseBenchmarkOptions(argc, argv);
+	} catch (const std::runtime_error& e) {
+		std::cerr << e.what() << std::endl << std::endl;
+		std::cerr << getBenchmarkUsage(argv[0]);
+		return 2;
+	}
+	if (options.show_help) {
+		std::cout << getBenchmarkUsage(argv[0]);
+		return 0;
+	}
+
+	const PacketKernels* packet_kernels = nullptr;
+	if (options.simd == "auto") {
+		packet_kernels = &getPacketKernels();
+	} else if (options.simd != "off") {
+		packet_kernels = getPacketKernels(options.simd);
+		if (!packet_kernels) {
+			std::cerr << "Instruction set '" << options.simd
+				<< "' isn't supported on this machine." << std::endl;
+			return 2;
+		}
+	}
+
+	std::ofstream output_file;
+	std::ostream json(std::cout.rdbuf());
+	if (!options.output_filename.empty()) {
+		output_file.open(options.output_filename);
+		if (!output_file) {
+			std::cerr << "Couldn't open " << options.output_filename << " for writing."
+				<< std::endl;
+			return 1;
+		}
+		json.rdbuf(output_file.rdbuf());
+	}
+	if (options.verify_shadows) {
+		std::vector<std::string> filenames = getSceneFilenames();
+		if (filenames.empty()) {
+			std::cerr << "No scenes to check." << std::endl;
+			return 1;
+		}
+		size_t mismatch_count = 0;
+		for (const std::string& filename : filenames) {
+			BenchmarkScene scene;
+			try {
+				loadSceneFile(filename, &scene);
+			} catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+			mismatch_count += verifyShadows(scene, packet_kernels);
+		}
+		if (mismatch_count > 0) {
+			std::cerr << mismatch_count << " shadow rays didn't match." << std::endl;
+			return 1;
+		}
+		std::cerr << "All shadow rays matched." << std::endl;
+		return 0;
+	}
+
+	if (options.time_triangle_kernel) {
+		runTriangleKernelBenchmark(options, &json);
+		if (!json) {
+			std::cerr << "Failed to write results." << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	// anything else printed (like the messages from loading models) goes to
+	// standard error, so it doesn't get mixed into the JSON
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	// each one is made just before it's rendered and freed straight after, so only
+	// one scene is in memory at a time
+	std::vector<std::function<void (BenchmarkScene* const&)>> scene_makers;
+	for (const std::string& filename : getSceneFilenames()) {
+		scene_makers.push_back([filename](BenchmarkScene* const& scene) {
+			loadSceneFile(filename, scene);
+		});
+	}
+	if (options.include_stress_scenes) {
+		scene_makers.push_back([](BenchmarkScene* const& scene) {
+			makeSphereGridScene(100, scene);
+		});
+		scene_makers.push_back(makeMapScene);
+	}
+
+	size_t thread_count =
+		options.thread_count ? options.thread_count : Renderer::getDefaultThreadCount();
+	json << "{" << std::endl
+		<< "\t\"threads\": " << thread_count << "," << std::endl
+		<< "\t\"packets\": "
+		<< toJsonString(packet_kernels ? packet_kernels->name : "off") << ","
+		<< std::endl
+		<< "\t\"repetitions\": " << options.repetitions << "," << std::endl
+		<< "\t\"scenes\": [" << std::endl;
+	for (size_t i = 0; i < scene_makers.size(); i++) {
+		std::unique_ptr<BenchmarkScene> scene(new BenchmarkScene());
+		try {
+			scene_makers[i](scene.get());
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		runBenchmark(*scene, options, packet_kernels, &json);
+		json << (i + 1 < scene_makers.size() ? "," : "") << std::endl;
+	}
+	json << "\t]" << std::endl << "}" << std::endl;
+
+	if (!json) {
+		std::cerr << "Failed to write results." << std::endl;
+		return 1;
+	}
+	if (Profiler::is_enabled) {
+		Profiler::writeSummary(std::cerr);
+	}
+	if (
+		!options.profile_filename.empty() &&
+		!Profiler::writeTrace(options.profile_filename)
+	) {
+		std::cerr << "Failed to write profile trace to " << options.profile_filename
+			<< "." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+BenchmarkOptions parseBenchmarkOptions(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--repetitions") {
+			options.repetitions = cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--threads") {
+			options.thread_count = cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--simd") {
+			options.simd = cli::getOptionValue(argc, argv, &i);
+			if (
+				options.simd != "auto" && options.simd != "avx2" && options.simd != "sse" &&
+				options.simd != "scalar" && options.simd != "off"
+			) {
+				throw std::runtime_error(
+					"Option '--simd' expects one of auto, avx2, sse, scalar or off, got '" +
+						options.simd + "'."
+				);
+			}
+		} else if (arg == "--out") {
+			options.output_filename = cli::getOptionValue(argc, argv, &i);
+		} else if (arg == "--no-stress") {
+			options.include_stress_scenes = false;
+		} else if (arg == "--profile") {
+			options.profile_filename = cli::getOptionValue(argc, argv, &i);
+			if (!Profiler::is_enabled) {
+				throw std::runtime_error(
+					"Option '--profile' requires a build with RAYTRACER_PROFILING on."
+				);
+			}
+		} else if (arg == "--verify-shadows") {
+			options.verify_shadows = true;
+		} else if (arg == "--triangle-kernel") {
+			options.time_triangle_kernel = true;
+		} else if (arg == "--help" || arg == "-h") {
+			options.show_help = true;
+		} else {
+			throw std::runtime_error("Unknown option '" + arg + "'.");
+		}
+	}
+	return options;
+}
+
+std::string getBenchmarkUsage(const std::string& program_name)
+{
+	return "Usage: " + program_name + " [options]\n"
+		"\n"
+		"Renders each scene in the scenes directory, then a grid of a million spheres\n"
+		"and map.obj at 3840x2160, without displaying or saving them, and writes the\n"
+		"time taken, rays traced and memory used for each as JSON.\n"
+		"\n"
+		"Options:\n"
+		"  --repetitions <n>  Times to render each scene (default: 3)\n"
+		"  --threads <n>      Number of render threads (default: one per hardware\n"
+		"                     thread)\n"
+		"  --simd <set>       Instruction set for tracing primary rays in packets:\n"
+		"                     auto (default), avx2, sse, scalar, or off\n"
+		"  --out <file>       Write the JSON here instead of to standard output\n"
+		"  --no-stress        Only render the scenes in the scenes directory\n"
+		"  --profile <file>   Write a Chrome trace of where the time went here\n"
+		"                     (only in builds with RAYTRACER_PROFILING on, which\n"
+		"                     also print a summary of it at the end)\n"
+		"  --verify-shadows   Instead of benchmarking, check the shadow rays cast\n"
+		"                     from each scene's primary hits against a brute-force\n"
+		"                     test of every object, and exit with status 1 if any\n"
+		"                     disagree\n"
+		"  --triangle-kernel  Instead of rendering, time ray-triangle tests on their\n"
+		"                     own, with the current test and the plane and\n"
+		"                     inside-outside test it replaced, and write the\n"
+		"                     nanoseconds per test of each as JSON\n"
+		"  --help, -h         Print this message and exit\n";
+}
+
+std::vector<std::string> getSceneFilenames()
+{
+	std::vector<std::string> filenames;
+	if (!fs::is_directory(scenes_dir)) {
+		std::cerr << scenes_dir << " is not a directory, so only stress scenes are run."
+			<< std::endl;
+		return filenames;
+	}
+	for (fs::directory_iterator itr{scenes_dir}; itr != fs::directory_iterator{}; ++itr) {
+		const fs::path& path = itr->path();
+		if (fs::is_regular_file(path) && path.extension() == ".txt") {
+			filenames.push_back(path.string());
+		}
+	}
+	std::sort(filenames.begin(), filenames.end());
+	return filenames;
+}
+
+void loadSceneFile(const std::string& filename, BenchmarkScene* const& scene)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	loadScene(filename, &scene->camera, &scene->lights, &scene->objects);
+	scene->load_milliseconds = millisecondsSince(start);
+	scene->name = fs::path(filename).stem().string();
+}
+
+void makeSphereGridScene(const unsigned int& side, BenchmarkScene* const& scene)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const float spacing = 2.0f;
+	const float radius = 0.6f;
+	float extent = side * spacing;
+	// far enough back for the front of the grid to fill the 60 degree view
+	glm::vec3 center(0.0f, 0.0f, -extent * 1.4f);
+	scene->objects.reserve(side * side * side);
+	for (unsigned int x = 0; x < side; x++) {
+		for (unsigned int y = 0; y < side; y++) {
+			for (unsigned int z = 0; z < side; z++) {
+				glm::vec3 cell(x, y, z);
+				glm::vec3 color = (cell + 0.5f) / (float)side;
+				scene->objects.push_back(new Sphere(
+					center + (cell - (side - 1) / 2.0f) * spacing,
+					radius,
+					color * 0.2f,
+					color * 0.6f,
+					glm::vec3(0.3f, 0.3f, 0.3f),
+					8.0f
+				));
+			}
+		}
+	}
+	scene->camera = Camera(
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::radians(60.0f),
+		// 480 pixels high
+		240.0f / std::tan(glm::radians(30.0f)),
+		4.0f / 3.0f
+	);
+	scene->lights.push_back(
+		Light(glm::vec3(extent, extent, 0.0f), glm::vec3(0.6f, 0.6f, 0.6f))
+	);
+	scene->lights.push_back(
+		Light(glm::vec3(-extent, 0.0f, 0.0f), glm::vec3(0.3f, 0.3f, 0.4f))
+	);
+	scene->load_milliseconds = millisecondsSince(start);
+	scene->name = "spheres_" + std::to_string(side * side * side);
+}
+
+void makeMapScene(BenchmarkScene* const& scene)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	TriangleMesh mesh = ObjModel::loadMesh((models_dir / "map.obj").string());
+	scene->objects.push_back(new ObjModel(
+		mesh,
+		glm::vec3(0.5f, 0.2f, 0.7f),
+		glm::vec3(0.2f, 0.4f, 0.2f),
+		glm::vec3(0.1f, 0.7f, 0.2f),
+		0.5f
+	));
+	AABB bounds = mesh.getBounds();
+	glm::vec3 center = (bounds.min + bounds.max) / 2.0f;
+	glm::vec3 size = bounds.max - bounds.min;
+	float extent = std::max(size.x, std::max(size.y, size.z));
+	glm::vec3 camera_position = center + glm::vec3(0.0f, 0.6f, 1.0f) * extent;
+	scene->camera = Camera(
+		camera_position,
+		glm::radians(60.0f),
+		// 2160 pixels high
+		1080.0f / std::tan(glm::radians(30.0f)),
+		16.0f / 9.0f,
+		center - camera_position
+	);
+	scene->lights.push_back(Light(
+		center + glm::vec3(0.5f, 1.0f, 0.2f) * extent,
+		glm::vec3(0.9f, 0.9f, 0.9f)
+	));
+	scene->load_milliseconds = millisecondsSince(start);
+	scene->name = "map_4k";
+}
+
+void runBenchmark(
+	const BenchmarkScene& scene,
+	const BenchmarkOptions& options,
+	const PacketKernels* const& packet_kernels,
+	std::ostream* const& json
+) {
+	std::cerr << "Benchmarking " << scene.name << "..." << std::endl;
+	bool is_peak_per_scene = resetPeakResidentMemory();
+
+	SceneBVH scene_bvh(scene.objects);
+	std::vector<double> frame_milliseconds;
+	RayCounts ray_counts;
+	for (size_t repetition = 0; repetition < options.repetitions; repetition++) {
+		Renderer renderer(scene.camera, scene.lights, scene_bvh, options.thread_count);
+		renderer.setPacketKernels(packet_kernels);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		renderer.start();
+		renderer.wait();
+		frame_milliseconds.push_back(millisecondsSince(start));
+		// (the same every time)
+		ray_counts = renderer.getRayCounts();
+	}
+
+	double total_milliseconds = 0.0;
+	for (double milliseconds : frame_milliseconds) {
+		total_milliseconds += milliseconds;
+	}
+	double mean_milliseconds = total_milliseconds / frame_milliseconds.size();
+	unsigned long long ray_count =
+		ray_counts.primary_rays + ray_counts.secondary_rays + ray_counts.shadow_rays;
+
+	std::ostream& out = *json;
+	out << "\t\t{" << std::endl
+		<< "\t\t\t\"name\": " << toJsonString(scene.name) << "," << std::endl
+		<< "\t\t\t\"width\": " << scene.camera.getPixelWidth() << "," << std::endl
+		<< "\t\t\t\"height\": " << scene.camera.getPixelHeight() << "," << std::endl
+		<< "\t\t\t\"objects\": " << scene.objects.size() << "," << std::endl
+		<< "\t\t\t\"load_ms\": " << scene.load_milliseconds << "," << std::endl
+		<< "\t\t\t\"bvh_build_ms\": "
+		<< scene_bvh.getBVH().getBuildStats().build_milliseconds << "," << std::endl
+		<< "\t\t\t\"frame_ms\": [";
+	for (size_t i = 0; i < frame_milliseconds.size(); i++) {
+		out << (i > 0 ? ", " : "") << frame_milliseconds[i];
+	}
+	out << "]," << std::endl
+		<< "\t\t\t\"mean_frame_ms\": " << mean_milliseconds << "," << std::endl
+		<< "\t\t\t\"min_frame_ms\": "
+		<< *std::min_element(frame_milliseconds.begin(), frame_milliseconds.end()) << ","
+		<< std::endl
+		<< "\t\t\t\"primary_rays\": " << ray_counts.primary_rays << "," << std::endl
+		<< "\t\t\t\"secondary_rays\": " << ray_counts.secondary_rays << "," << std::endl
+		<< "\t\t\t\"shadow_rays\": " << ray_counts.shadow_rays << "," << std::endl
+		<< "\t\t\t\"rays_per_second\": "
+		<< (unsigned long long)(ray_count / (mean_milliseconds / 1000.0))
+		<< "," << std::endl
+		<< "\t\t\t\"peak_rss_kib\": " << getPeakResidentMemory() << "," << std::endl
+		<< "\t\t\t\"peak_rss_is_per_scene\": " << (is_peak_per_scene ? "true" : "false")
+		<< std::endl
+		<< "\t\t}";
+}
+
+size_t verifyShadows(
+	const BenchmarkScene& scene,
+	const PacketKernels* const& packet_kernels
+) {
+	// (only this many mismatches are printed per scene)
+	const size_t max_reported = 10;
+
+	SceneBVH scene_bvh(scene.objects);
+	auto isBlockingReference = [&](
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) {
+		float closest_t = std::numeric_limits<float>::max();
+		for (Object3D* const& object : scene.objects) {
+			float t;
+			glm::vec3 normal;
+			if (object->doesRayIntersect(origin, direction, &t, &normal)) {
+				closest_t = std::min(closest_t, t);
+			}
+		}
+		return closest_t < t_max;
+	};
+
+	size_t ray_count = 0;
+	size_t mismatch_count = 0;
+	auto reportMismatch = [&](
+		const std::string& test_name,
+		const unsigned int& x,
+		const unsigned int& y,
+		const size_t& light_index,
+		const unsigned int& sample_index,
+		const bool& is_blocked
+	) {
+		if (mismatch_count++ < max_reported) {
+			std::cerr << scene.name << ": " << test_name << " says the shadow ray from ("
+				<< x << ", " << y << ") to sample " << sample_index << " of light "
+				<< light_index << " is " << (is_blocked ? "" : "not ") << "blocked"
+				<< std::endl;
+		}
+	};
+
+	glm::vec3 camera_position = scene.camera.getPosition();
+	unsigned int width = scene.camera.getPixelWidth();
+	unsigned int pixel_count = width * scene.camera.getPixelHeight();
+	for (unsigned int pixel = 0; pixel < pixel_count; pixel++) {
+		unsigned int x = pixel % width;
+		unsigned int y = pixel / width;
+		glm::vec3 direction = scene.camera.getRayDirection(x + 0.5f, y + 0.5f);
+		float t;
+		glm::vec3 normal;
+		Object3D* object;
+		if (
+			!scene_bvh.doesRayIntersect(camera_position, direction, &t, &normal, &object)
+		) {
+			continue;
+		}
+		// as getColorForRay places shadow rays
+		glm::vec3 shadow_origin = camera_position + direction * t + normal *
+			(glm::dot(normal, direction) > 0.0f ? -shadow_bias : shadow_bias);
+		// (shading seeds by hashing the ray, but any seed gives a valid set of samples)
+		uint32_t seed = pixel;
+
+		for (size_t i = 0; i < scene.lights.size(); i++) {
+			const Light& light = scene.lights[i];
+			unsigned int sample_count = light.getSampleCount();
+			std::vector<glm::vec3> directions(sample_count);
+			std::vector<float> lengths(sample_count);
+			std::vector<bool> are_blocked(sample_count);
+			for (unsigned int j = 0; j < sample_count; j++) {
+				glm::vec3 light_point = light.getSamplePoint(shadow_origin, j, seed);
+				// the same direction and length isBlockingSegment works out
+				glm::vec3 segment = light_point - shadow_origin;
+				lengths[j] = glm::length(segment);
+				directions[j] = segment / lengths[j];
+				are_blocked[j] =
+					isBlockingReference(shadow_origin, directions[j], lengths[j]);
+				bool is_blocked = scene_bvh.isBlockingSegment(shadow_origin, light_point);
+				if (is_blocked != are_blocked[j]) {
+					reportMismatch("isBlockingSegment", x, y, i, j, is_blocked);
+				}
+			}
+			ray_count += sample_count;
+
+			if (!packet_kernels) {
+				continue;
+			}
+			// grouped as getLightVisibility groups them, but without stopping early
+			for (unsigned int begin = 0; begin < sample_count; begin += RayPacket::size) {
+				unsigned int count = std::min(sample_count - begin, RayPacket::size);
+				RayPacket packet;
+				for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+					bool is_sample = lane < count;
+					unsigned int j = begin + (is_sample ? lane : 0);
+					packet.setRay(lane, shadow_origin, directions[j], is_sample);
+					if (is_sample) {
+						packet.t[lane] = lengths[j];
+					}
+				}
+				unsigned int occluded_mask =
+					scene_bvh.occludePacket(&packet, *packet_kernels);
+				for (unsigned int lane = 0; lane < count; lane++) {
+					bool is_occluded = (occluded_mask & (1u << lane)) != 0;
+					if (is_occluded != are_blocked[begin + lane]) {
+						reportMismatch(
+							"occludePacket",
+							x,
+							y,
+							i,
+							begin + lane,
+							is_occluded
+						);
+					}
+				}
+			}
+		}
+	}
+
+	std::cerr << scene.name << ": " << ray_count << " shadow rays, " << mismatch_count
+		<< " mismatches" << std::endl;
+	return mismatch_count;
+}
+
+void makeTriangleKernelInput(const size_t& count, TriangleKernelInput* const& input)
+{
+	SampleRandom random(0, 0, 0);
+	auto nextPoint = [&]() {
+		float x = random.nextFloat();
+		float y = random.nextFloat();
+		return glm::vec3(x, y, random.nextFloat());
+	};
+	glm::vec3 cube_center(0.5f, 0.5f, 0.5f);
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 vertex1 = nextPoint();
+		glm::vec3 edge1_2 = (nextPoint() - cube_center) * 0.2f;
+		glm::vec3 edge1_3 = (nextPoint() - cube_center) * 0.2f;
+		glm::vec3 normal = glm::normalize(glm::cross(edge1_2, edge1_3));
+		input->vertices1.push_back(vertex1);
+		input->edges1_2.push_back(edge1_2);
+		input->edges1_3.push_back(edge1_3);
+		input->normals.push_back(normal);
+		input->plane_distances.push_back(glm::dot(normal, vertex1));
+
+		AABB bounds;
+		bounds.expand(vertex1);
+		bounds.expand(vertex1 + edge1_2);
+		bounds.expand(vertex1 + edge1_3);
+		glm::vec3 target = bounds.min + (bounds.max - bounds.min) * nextPoint();
+		// (a point in the cube, pushed out onto the sphere of radius 2 around it)
+		glm::vec3 origin = cube_center + glm::normalize(nextPoint() - cube_center) * 2.0f;
+		input->origins.push_back(origin);
+		input->directions.push_back(glm::normalize(target - origin));
+	}
+}
+
+bool doesRayIntersectTrianglePlane(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const glm::vec3& vertex1,
+	const glm::vec3& edge1_2,
+	const glm::vec3& edge1_3,
+	const glm::vec3& normal,
+	const float& plane_distance,
+	float* const& t
+) {
+	*t = (plane_distance - glm::dot(normal, origin)) / glm::dot(normal, direction);
+	if (*t < t_threshold || std::isnan(*t)) {
+		return false;
+	}
+
+	glm::vec3 vec1_p = origin + direction * *t - vertex1;
+
+	if (glm::dot(normal, glm::cross(edge1_2, vec1_p)) < 0) {
+		// wrong side
+		return false;
+	}
+
+	// edge vertex2 -> vertex3, from vertex2 to p
+	if (glm::dot(normal, glm::cross(edge1_3 - edge1_2, vec1_p - edge1_2)) < 0) {
+		// wrong side
+		return false;
+	}
+
+	// edge vertex3 -> vertex1, from vertex3 to p
+	if (glm::dot(normal, glm::cross(-edge1_3, vec1_p - edge1_3)) < 0) {
+		// wrong side
+		return false;
+	}
+
+	return true;
+}
+
+void runTriangleKernelBenchmark(
+	const BenchmarkOptions& options,
+	std::ostream* const& json
+) {
+	// (small enough for the data to stay in cache, so the tests themselves are timed,
+	// and tested enough times over to take a few tenths of a second per repetition)
+	const size_t pair_count = 1 << 14;
+	const size_t passes = 1 << 10;
+	std::cerr << "Timing triangle tests..." << std::endl;
+	TriangleKernelInput input;
+	makeTriangleKernelInput(pair_count, &input);
+
+	auto testPlane = [&input](const size_t& i, float* const& t) {
+		return doesRayIntersectTrianglePlane(
+			input.origins[i],
+			input.directions[i],
+			input.vertices1[i],
+			input.edges1_2[i],
+			input.edges1_3[i],
+			input.normals[i],
+			input.plane_distances[i],
+			t
+		);
+	};
+	auto testMollerTrumbore = [&input](const size_t& i, float* const& t) {
+		float u, v;
+		return doesRayIntersectTriangle(
+			input.origins[i],
+			input.directions[i],
+			input.vertices1[i],
+			input.edges1_2[i],
+			input.edges1_3[i],
+			t,
+			&u,
+			&v
+		);
+	};
+
+	double plane_nanoseconds = std::numeric_limits<double>::max();
+	double moller_trumbore_nanoseconds = std::numeric_limits<double>::max();
+	size_t plane_hit_count = 0;
+	size_t moller_trumbore_hit_count = 0;
+	for (size_t repetition = 0; repetition < options.repetitions; repetition++) {
+		plane_nanoseconds = std::min(
+			plane_nanoseconds,
+			timeTriangleTests(input, passes, testPlane, &plane_hit_count)
+		);
+		moller_trumbore_nanoseconds = std::min(
+			moller_trumbore_nanoseconds,
+			timeTriangleTests(
+				input,
+				passes,
+				testMollerTrumbore,
+				&moller_trumbore_hit_count
+			)
+		);
+	}
+
+	std::ostream& out = *json;
+	out << "{" << std::endl
+		<< "\t\"tests\": " << pair_count * passes << "," << std::endl
+		<< "\t\"repetitions\": " << options.repetitions << "," << std::endl
+		<< "\t\"kernels\": [" << std::endl
+		<< "\t\t{" << std::endl
+		<< "\t\t\t\"name\": \"plane_inside_outside\"," << std::endl
+		<< "\t\t\t\"ns_per_test\": " << plane_nanoseconds << "," << std::endl
+		<< "\t\t\t\"hit_rate\": " << (double)plane_hit_count / pair_count << std::endl
+		<< "\t\t}," << std::endl
+		<< "\t\t{" << std::endl
+		<< "\t\t\t\"name\": \"moller_trumbore\"," << std::endl
+		<< "\t\t\t\"ns_per_test\": " << moller_trumbore_nanoseconds << "," << std::endl
+		<< "\t\t\t\"hit_rate\": " << (double)moller_trumbore_hit_count / pair_count
+		<< std::endl
+		<< "\t\t}" << std::endl
+		<< "\t]" << std::endl
+		<< "}" << std::endl;
+}
+
+template <typename Test>
+double timeTriangleTests(
+	const TriangleKernelInput& input,
+	const size_t& passes,
+	Test test,
+	size_t* const& hit_count
+) {
+	size_t count = input.origins.size();
+	size_t total_hit_count = 0;
+	// summed so the compiler can't leave out working out t
+	float t_sum = 0.0f;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < count; i++) {
+			float t;
+			if (test(i, &t)) {
+				total_hit_count++;
+				t_sum += t;
+			}
+		}
+	}
+	double milliseconds = millisecondsSince(start);
+	// (never true, as t is positive for every hit)
+	if (t_sum < 0.0f) {
+		std::cerr << t_sum << std::endl;
+	}
+	*hit_count = total_hit_count / passes;
+	return milliseconds * 1000000.0 / (count * passes);
+}
+
+bool resetPeakResidentMemory()
+{
+#ifdef __linux__
+	// (writing 5 resets the peak to the current resident set size)
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.close();
+	return !clear_refs.fail();
+#else
+	return false;
+#endif
+}
+
+size_t getPeakResidentMemory()
+{
+#ifdef __linux__
+	// getrusage's peak isn't reset along with this one
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (boost::algorithm::starts_with(line, "VmHWM:")) {
+			return std::stoul(line.substr(6));
+		}
+	}
+#endif
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	// in bytes on macOS
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+std::string toJsonString(const std::string& value)
+{
+	std::string escaped = "\"";
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped + "\"";
+}
+
+double millisecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start
+	).count();
+}
@@ -8,7 +8,26 @@ namespace fs = boost::filesystem;
 static fs::path scenes_dir = fs::path("..") / fs::path("scenes");
 static fs::path models_dir = fs::path("..") / fs::path("models");
 static fs::path renders_dir = fs::path("..") / fs::path("renders");
+static fs::path cache_dir = fs::path("..") / fs::path("cache");
 
 static const float t_threshold = 0.00f;
+// shadow rays start this far off the surface they leave from, so that
+// rounding error doesn't make the surface shadow itself
+static const float shadow_bias = 0.001f;
+
+// reflected and refracted rays (and paths, when path tracing) stop after this many
+// bounces
+static const unsigned int max_ray_depth = 8;
+// secondary rays which would add less than this to every channel of a pixel's
+// color aren't traced at all
+static const float min_ray_contribution = 0.5f / 255.0f;
+// and those adding less than this in every channel survive Russian roulette with
+// a chance in proportion to their contribution, which survivors are weighted up by
+// to make up for the rest
+static const float roulette_contribution = 0.05f;
+// when path tracing, paths play Russian roulette from this many bounces on
+static const unsigned int path_roulette_depth = 3;
+// samples per pixel when path tracing, unless told otherwise
+static const unsigned int default_path_samples = 16;
 
 #endif //RAYTRACER_CONSTANTS_HPP
@@ -1,8 +1,8 @@
 #include <glm/glm.hpp>
-#include <vector>
 #include <cmath>
-#include <cstdlib>
-#include <algorithm>
+#include <stdexcept>
+
+#include <src/profiling/Profiler.hpp>
 
 #include "Camera.hpp"
 
@@ -10,14 +10,22 @@ Camera::Camera(
 	const glm::vec3& position,
 	float fov_y,
 	float focal_length,
-	float aspect_ratio
+	float aspect_ratio,
+	const glm::vec3& direction,
+	const glm::vec3& up
 ) : position(position),
     fov_y(fov_y),
     focal_length(focal_length),
     aspect_ratio(aspect_ratio)
 {
-	// negative-Z axis unit vector
-	static glm::vec3 forward(0.0f, 0.0f, -1.0f);
+	PROFILE_SCOPE(camera_setup);
+	glm::vec3 right = glm::cross(direction, up);
+	if (glm::length(right) == 0.0f) {
+		throw std::invalid_argument("Camera direction must be nonzero and not along up.");
+	}
+	this->forward = glm::normalize(direction);
+	this->right = glm::normalize(right);
+	this->up = glm::cross(this->right, this->forward);
 
 	double height = 2 * focal_length * tan((double)fov_y / 2.0);
 	double width = aspect_ratio * height;
@@ -25,30 +33,11 @@ Camera::Camera(
 	this->pixel_height = (unsigned int)round(height);
 	this->pixel_width = (unsigned int)round(width);
 
-	glm::vec3 image_center = position + forward * focal_length;
+	glm::vec3 image_center = position + this->forward * focal_length;
 	// bottom_left is a CENTER of bottom left pixel, not at its bottom left corner.
-	glm::vec3 bottom_left = image_center -
-		glm::vec3(this->pixel_width / 2.0f + 0.5f, this->pixel_height / 2.0f + 0.5f, 0.0f);
-
-	for (int row = 0; row < this->pixel_height; row++) {
-		for (int col = 0; col < this->pixel_width; col++) {
-			this->rays.emplace_back(
-				// unit vector pointing in direction from camera position to pixel
-				glm::normalize(
-					glm::vec3(bottom_left.x + col, bottom_left.y + row, bottom_left.z) -
-						this->position
-				),
-				// position in image (smaller y at top for image)
-				(this->pixel_height - row - 1) * this->pixel_width + col
-			);
-		}
-	}
-
-	// Fisher-Yates Shuffle (so whole image appears gradually)
-	for (size_t i = this->rays.size(); i--; ) {
-		size_t j = rand() % (i + 1);
-		std::iter_swap(this->rays.begin() + i, this->rays.begin() + j);
-	}
+	this->bottom_left = image_center -
+		this->right * (this->pixel_width / 2.0f + 0.5f) -
+		this->up * (this->pixel_height / 2.0f + 0.5f);
 }
 
 glm::vec3 Camera::getPosition() const
@@ -56,12 +45,24 @@ glm::vec3 Camera::getPosition() const
 	return this->position;
 }
 
-const std::vector<std::pair<glm::vec3, int>>& Camera::getRays(
-	unsigned int* const& pixel_width,
-	unsigned int* const& pixel_height
-) const
+unsigned int Camera::getPixelWidth() const
+{
+	return this->pixel_width;
+}
+
+unsigned int Camera::getPixelHeight() const
+{
+	return this->pixel_height;
+}
+
+glm::vec3 Camera::getRayDirection(const float& x, const float& y) const
 {
-	(*pixel_width) = this->pixel_width;
-	(*pixel_height) = this->pixel_height;
-	return this->rays;
+	// pixel centers in the image plane are a whole pixel apart, with row 0 at the
+	// bottom
+	return glm::normalize(
+		this->bottom_left +
+			this->right * (x - 0.5f) +
+			this->up * (this->pixel_height - y - 0.5f) -
+			this->position
+	);
 }
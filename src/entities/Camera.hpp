@@ -2,10 +2,11 @@
 #define RAYTRACER_CAMERA_HPP
 
 #include <glm/glm.hpp>
-#include <vector>
-#include <utility>
 
-// always points along negative-Z axis
+// Points along direction (negative-Z axis by default), with the image's rows
+// running along the axis at right angles to both direction and up. Rays are
+// generated from pixel coordinates as they're needed, so a camera takes the same
+// memory whatever the size of the image.
 
 class Camera {
 private:
@@ -15,18 +16,30 @@ private:
 	float aspect_ratio; // width / height
 	unsigned int pixel_width;
 	unsigned int pixel_height;
-	// randomly-ordered vector, containing pairs of:
-	//  - ray direction vector
-	//  - int indicating position in image
-	std::vector<std::pair<glm::vec3, int>> rays;
+	// orthonormal basis: image rows run along right and columns along up, with
+	// forward pointing from the camera to the image's center
+	glm::vec3 right;
+	glm::vec3 up;
+	glm::vec3 forward;
+	// center of the bottom left pixel of the image plane
+	glm::vec3 bottom_left;
 public:
 	Camera() : Camera(glm::vec3(0.0f, 0.0f, 0.0f), (float)M_PI / 4, 1.0f, 1.3) {}
-	Camera(const glm::vec3& position, float fov_y, float focal_length, float aspect_ratio);
+	// throws std::invalid_argument if direction is 0 or parallel to up
+	Camera(
+		const glm::vec3& position,
+		float fov_y,
+		float focal_length,
+		float aspect_ratio,
+		const glm::vec3& direction = glm::vec3(0.0f, 0.0f, -1.0f),
+		const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f)
+	);
 	glm::vec3 getPosition() const;
-	const std::vector<std::pair<glm::vec3, int>>& getRays(
-		unsigned int* const& pixel_width,
-		unsigned int* const& pixel_height
-	) const;
+	unsigned int getPixelWidth() const;
+	unsigned int getPixelHeight() const;
+	// unit vector from the camera through point (x, y) of the image, measured in
+	// pixels from its top left corner (so pixel centers are at halves)
+	glm::vec3 getRayDirection(const float& x, const float& y) const;
 };
 
 
@@ -1,9 +1,97 @@
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <src/hashBits.hpp>
 
 #include "Light.hpp"
 
+namespace {
+	unsigned int getGreatestCommonDivisor(unsigned int a, unsigned int b)
+	{
+		while (b != 0) {
+			unsigned int remainder = a % b;
+			a = b;
+			b = remainder;
+		}
+		return a;
+	}
+
+	// maps a point of the square [0, 1) x [0, 1) onto the unit disk, keeping
+	// strata of the square compact (Shirley and Chiu's concentric mapping)
+	glm::vec2 getDiskPoint(const float& u, const float& v)
+	{
+		float a = 2.0f * u - 1.0f;
+		float b = 2.0f * v - 1.0f;
+		if (a == 0.0f && b == 0.0f) {
+			return glm::vec2(0.0f, 0.0f);
+		}
+		float radius;
+		float angle;
+		if (std::abs(a) > std::abs(b)) {
+			radius = a;
+			angle = (float)M_PI / 4.0f * (b / a);
+		} else {
+			radius = b;
+			angle = (float)M_PI / 2.0f - (float)M_PI / 4.0f * (a / b);
+		}
+		return glm::vec2(radius * (float)cos(angle), radius * (float)sin(angle));
+	}
+}
+
+Light::Light(
+	const glm::vec3& position,
+	const glm::vec3& color,
+	const LightShape& shape,
+	const unsigned int& sample_count
+) : position(position),
+    color(color),
+    shape(shape),
+    edge_a(0.0f, 0.0f, 0.0f),
+    edge_b(0.0f, 0.0f, 0.0f),
+    radius(0.0f)
+{
+	this->strata_across =
+		std::max(1u, (unsigned int)round(sqrt((double)sample_count)));
+	this->strata_down = std::max(
+		1u,
+		(sample_count + this->strata_across - 1) / this->strata_across
+	);
+	// close to the golden ratio of the count
+	unsigned int stratum_count = this->strata_across * this->strata_down;
+	this->stratum_step = std::max(1u, (unsigned int)(stratum_count * 0.618f));
+	while (getGreatestCommonDivisor(this->stratum_step, stratum_count) != 1) {
+		this->stratum_step++;
+	}
+}
+
 Light::Light(const glm::vec3& position, const glm::vec3& color)
-	: position(position), color(color) {}
+	: Light(position, color, LightShape::point, 1) {}
+
+Light Light::makeRectangle(
+	const glm::vec3& position,
+	const glm::vec3& edge_a,
+	const glm::vec3& edge_b,
+	const glm::vec3& color,
+	const unsigned int& sample_count
+) {
+	Light light(position, color, LightShape::rectangle, sample_count);
+	light.edge_a = edge_a;
+	light.edge_b = edge_b;
+	return light;
+}
+
+Light Light::makeSphere(
+	const glm::vec3& position,
+	const float& radius,
+	const glm::vec3& color,
+	const unsigned int& sample_count
+) {
+	Light light(position, color, LightShape::sphere, sample_count);
+	light.radius = radius;
+	return light;
+}
 
 glm::vec3 Light::getPosition() const
 {
@@ -14,3 +102,49 @@ glm::vec3 Light::getColor() const
 {
 	return this->color;
 }
+
+LightShape Light::getShape() const
+{
+	return this->shape;
+}
+
+unsigned int Light::getSampleCount() const
+{
+	return this->shape == LightShape::point ? 1 : this->strata_across * this->strata_down;
+}
+
+glm::vec3 Light::getSamplePoint(
+	const glm::vec3& viewpoint,
+	const unsigned int& sample_index,
+	const uint32_t& seed
+) const
+{
+	if (this->shape == LightShape::point) {
+		return this->position;
+	}
+
+	unsigned int stratum = (sample_index * this->stratum_step) % this->getSampleCount();
+	// position within the stratum
+	uint32_t stratum_hash = mixBits(seed ^ (stratum * 0x9e3779b9u));
+	float u = (stratum % this->strata_across + toUnitFloat(stratum_hash)) /
+		this->strata_across;
+	float v = (stratum / this->strata_across + toUnitFloat(mixBits(stratum_hash))) /
+		this->strata_down;
+
+	if (this->shape == LightShape::rectangle) {
+		return this->position + this->edge_a * (u - 0.5f) + this->edge_b * (v - 0.5f);
+	}
+
+	// the disk through the sphere's center, facing viewpoint
+	glm::vec3 normal = viewpoint - this->position;
+	float distance = glm::length(normal);
+	normal = distance > 0.0f ? normal / distance : glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec3 helper = std::abs(normal.x) > 0.9f ?
+		glm::vec3(0.0f, 1.0f, 0.0f) :
+		glm::vec3(1.0f, 0.0f, 0.0f);
+	glm::vec3 tangent = glm::normalize(glm::cross(helper, normal));
+	glm::vec3 bitangent = glm::cross(normal, tangent);
+	glm::vec2 disk_point = getDiskPoint(u, v);
+	return this->position +
+		(tangent * disk_point.x + bitangent * disk_point.y) * this->radius;
+}
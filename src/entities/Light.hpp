@@ -2,15 +2,79 @@
 #define RAYTRACER_LIGHT_HPP
 
 #include <glm/glm.hpp>
+#include <cstdint>
+
+enum class LightShape {
+	point,
+	rectangle,
+	sphere
+};
+
+// A point light, or an area light (a rectangle or sphere), which casts soft
+// shadows. How much of an area light a surface sees is estimated from shadow rays
+// to sample points spread over it: its area is split into a grid of strata (as
+// near square as the sample count allows), and each sample is placed at random
+// within a stratum of its own, so samples cover the light evenly without lining up
+// into visible bands. Lights are shaded as if their light all came from their
+// center, dimmed by the fraction of samples seen.
 
 class Light {
 private:
 	glm::vec3 position;
 	glm::vec3 color;
+	LightShape shape;
+	// of a rectangle, running from one corner to the next two, across and down its
+	// strata
+	glm::vec3 edge_a;
+	glm::vec3 edge_b;
+	// of a sphere
+	float radius;
+	// strata across edge_a (or the sphere's disk) and down edge_b
+	unsigned int strata_across;
+	unsigned int strata_down;
+	// samples are taken from strata in steps of this many (a number with no factor
+	// in common with their count), so the first few are spread over the whole light
+	unsigned int stratum_step;
+
+	Light(
+		const glm::vec3& position,
+		const glm::vec3& color,
+		const LightShape& shape,
+		const unsigned int& sample_count
+	);
 public:
 	Light(const glm::vec3& position, const glm::vec3& color);
+	// rectangle centered on position. sample_count is rounded to fill a grid of
+	// strata.
+	static Light makeRectangle(
+		const glm::vec3& position,
+		const glm::vec3& edge_a,
+		const glm::vec3& edge_b,
+		const glm::vec3& color,
+		const unsigned int& sample_count
+	);
+	// sample_count is rounded to fill a grid of strata
+	static Light makeSphere(
+		const glm::vec3& position,
+		const float& radius,
+		const glm::vec3& color,
+		const unsigned int& sample_count
+	);
+	// the center of an area light
 	glm::vec3 getPosition() const;
 	glm::vec3 getColor() const;
+	LightShape getShape() const;
+	// 1 for a point light
+	unsigned int getSampleCount() const;
+	// Point sample_index (below getSampleCount()) of the light, as seen from
+	// viewpoint (which only matters for spheres, whose samples are spread over the
+	// disk facing it). Samples are placed within their strata by seed, so different
+	// seeds give different sets of samples.
+	glm::vec3 getSamplePoint(
+		const glm::vec3& viewpoint,
+		const unsigned int& sample_index,
+		const uint32_t& seed
+	) const;
 };
 
 
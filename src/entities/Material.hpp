@@ -0,0 +1,39 @@
+#ifndef RAYTRACER_MATERIAL_HPP
+#define RAYTRACER_MATERIAL_HPP
+
+#include <glm/glm.hpp>
+
+// Phong surface properties, stored by value in each Object3D so shading reads them
+// from the object itself instead of chasing pointers to heap-allocated colors.
+//
+// On top of its own (Phong) color, a surface can reflect what's in its mirror
+// direction, and be see-through, refracting light passing into (or out of) it.
+// Light arriving at a transparent surface is split between reflection and
+// refraction by the Fresnel equations (as approximated by Schlick).
+
+struct Material {
+	glm::vec3 ambient_color;
+	glm::vec3 diffuse_color;
+	glm::vec3 specular_color;
+	float shininess;
+	// fraction of the light from the mirror direction reflected, from 0 to 1
+	float reflectivity = 0.0f;
+	// fraction of the light from behind the surface let through (before what the
+	// Fresnel equations reflect), from 0 to 1
+	float transparency = 0.0f;
+	// of the inside of the object, the outside being taken as 1 (air)
+	float refractive_index = 1.0f;
+
+	Material(
+		const glm::vec3& ambient_color,
+		const glm::vec3& diffuse_color,
+		const glm::vec3& specular_color,
+		const float& shininess
+	) : ambient_color(ambient_color),
+		diffuse_color(diffuse_color),
+		specular_color(specular_color),
+		shininess(shininess) {}
+};
+
+
+#endif //RAYTRACER_MATERIAL_HPP
@@ -0,0 +1,140 @@
+#include <glm/glm.hpp>
+#include <stdexcept>
+#include <cmath>
+
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/accel/TriangleMesh.hpp>
+
+#include "Object3D.hpp"
+#include "MeshInstance.hpp"
+
+namespace {
+	// rotation by degrees about axis (0, 1 or 2 for x, y or z)
+	glm::mat3 axisRotation(const int& axis, const float& degrees)
+	{
+		float cosine = std::cos(glm::radians(degrees));
+		float sine = std::sin(glm::radians(degrees));
+		int a = (axis + 1) % 3;
+		int b = (axis + 2) % 3;
+		// indexed [column][row]
+		glm::mat3 rotation(1.0f);
+		rotation[a][a] = cosine;
+		rotation[a][b] = sine;
+		rotation[b][a] = -sine;
+		rotation[b][b] = cosine;
+		return rotation;
+	}
+}
+
+MeshInstance::MeshInstance(
+	const TriangleMesh& mesh,
+	const glm::vec3& position,
+	const glm::vec3& rotation,
+	const glm::vec3& scale,
+	const glm::vec3& ambient_color,
+	const glm::vec3& diffuse_color,
+	const glm::vec3& specular_color,
+	const float& shininess
+) : Object3D(ambient_color, diffuse_color, specular_color, shininess),
+    mesh(mesh),
+    position(position)
+{
+	if (scale.x == 0.0f || scale.y == 0.0f || scale.z == 0.0f) {
+		throw std::invalid_argument("Instance scale must not be 0.");
+	}
+	glm::mat3 object_rotation =
+		axisRotation(2, rotation.z) *
+		axisRotation(1, rotation.y) *
+		axisRotation(0, rotation.x);
+	glm::mat3 inverse_scale(1.0f);
+	inverse_scale[0][0] = 1.0f / scale.x;
+	inverse_scale[1][1] = 1.0f / scale.y;
+	inverse_scale[2][2] = 1.0f / scale.z;
+	// a rotation's inverse is its transpose
+	this->world_to_object = inverse_scale * glm::transpose(object_rotation);
+	this->normal_to_world = glm::transpose(this->world_to_object);
+
+	// bounds of the transformed corners of the mesh's bounds
+	glm::mat3 object_to_world = object_rotation;
+	object_to_world[0] *= scale.x;
+	object_to_world[1] *= scale.y;
+	object_to_world[2] *= scale.z;
+	AABB mesh_bounds = this->mesh.getBounds();
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 point(
+			corner & 1 ? mesh_bounds.max.x : mesh_bounds.min.x,
+			corner & 2 ? mesh_bounds.max.y : mesh_bounds.min.y,
+			corner & 4 ? mesh_bounds.max.z : mesh_bounds.min.z
+		);
+		this->bounds.expand(object_to_world * point + position);
+	}
+}
+
+bool MeshInstance::doesRayIntersect(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float* const& t,
+	glm::vec3* const& normal
+) const
+{
+	if (
+		!this->mesh.doesRayIntersect(
+			this->world_to_object * (origin - this->position),
+			this->world_to_object * direction,
+			t,
+			normal
+		)
+	) {
+		return false;
+	}
+	*normal = glm::normalize(this->normal_to_world * *normal);
+	return true;
+}
+
+unsigned int MeshInstance::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	RayPacket object_packet;
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		object_packet.setRay(
+			lane,
+			this->world_to_object * (packet->getOrigin(lane) - this->position),
+			this->world_to_object * packet->getDirection(lane)
+		);
+		// so only hits closer than the closest so far count
+		object_packet.t[lane] = packet->t[lane];
+	}
+	object_packet.lane_mask = packet->lane_mask;
+
+	unsigned int mask = this->mesh.intersectPacket(&object_packet, kernels);
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		if (mask & (1u << lane)) {
+			packet->t[lane] = object_packet.t[lane];
+			packet->normals[lane] =
+				glm::normalize(this->normal_to_world * object_packet.normals[lane]);
+		}
+	}
+	return mask;
+}
+
+bool MeshInstance::isBlockingRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max
+) const
+{
+	return this->mesh.isBlockingRay(
+		this->world_to_object * (origin - this->position),
+		this->world_to_object * direction,
+		t_max
+	);
+}
+
+AABB MeshInstance::getBounds() const
+{
+	return this->bounds;
+}
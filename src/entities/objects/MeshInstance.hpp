@@ -0,0 +1,61 @@
+#ifndef RAYTRACER_MESHINSTANCE_HPP
+#define RAYTRACER_MESHINSTANCE_HPP
+
+#include <glm/glm.hpp>
+
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/accel/TriangleMesh.hpp>
+
+#include "Object3D.hpp"
+
+// A placed copy of a mesh, with its own material. Rays are moved into the mesh's
+// own (object) space and traced against the mesh and BVH every instance of it
+// shares, so each instance only costs its transform.
+//
+// The mesh is scaled, then rotated about the x, y and z axes (in that order), then
+// translated to position. Ray directions are transformed without being normalized,
+// so t is the same in object and world space.
+
+class MeshInstance : public Object3D {
+private:
+	TriangleMesh mesh;
+	glm::vec3 position;
+	glm::mat3 world_to_object;
+	// inverse transpose of the object to world transform
+	glm::mat3 normal_to_world;
+	AABB bounds;
+public:
+	// rotation is in degrees. Throws std::invalid_argument if any component of scale
+	// is 0, which would flatten the mesh.
+	MeshInstance(
+		const TriangleMesh& mesh,
+		const glm::vec3& position,
+		const glm::vec3& rotation,
+		const glm::vec3& scale,
+		const glm::vec3& ambient_color,
+		const glm::vec3& diffuse_color,
+		const glm::vec3& specular_color,
+		const float& shininess
+	);
+	bool doesRayIntersect(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float* const& t,
+		glm::vec3* const& normal
+	) const override;
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const override;
+	bool isBlockingRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) const override;
+	AABB getBounds() const override;
+};
+
+
+#endif //RAYTRACER_MESHINSTANCE_HPP
@@ -3,63 +3,41 @@
 #include <vector>
 #include <stdexcept>
 #include <limits>
-
-#include <src/vendor/tiny_obj_loader.cc>
+#include <iostream>
+#include <chrono>
+
+#include <src/loadObj.hpp>
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/accel/BVH.hpp>
+#include <src/accel/TriangleMesh.hpp>
+#include <src/accel/MeshCache.hpp>
+#include <src/profiling/Profiler.hpp>
 
 #include "Object3D.hpp"
 #include "ObjModel.hpp"
 
+namespace {
+	// builds a mesh from the faces of every shape in the .obj file
+	TriangleMesh buildMesh(const std::string& filename)
+	{
+		ObjMesh obj = loadObj(filename);
+		if (obj.triangle_indices.empty()) {
+			throw std::runtime_error("Obj must contain faces!");
+		}
+		return TriangleMesh(obj.vertices, obj.triangle_indices);
+	}
+}
+
 ObjModel::ObjModel(
-	const std::string& filename,
+	const TriangleMesh& mesh,
 	const glm::vec3& ambient_color,
 	const glm::vec3& diffuse_color,
 	const glm::vec3& specular_color,
 	const float& shininess
-) : Object3D(ambient_color, diffuse_color, specular_color, shininess)
-{
-	// .obj loading code adapted from sample usage code at:
-	// https://github.com/syoyo/tinyobjloader/blob/b434c2497fcb52aa1497b84aa8aeb12bb590492d/README.md#example-code
-
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-
-	std::string err;
-
-	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename.c_str());
-
-	if (!err.empty()) {
-		throw std::runtime_error("Obj load failed: " + err);
-	}
-
-	if (shapes.empty()) {
-		throw std::runtime_error("Obj must contain shape!");
-	}
-
-	if (!ret) {
-		throw std::runtime_error("Obj load failed.");
-	}
-
-	// populate this->vertices
-	for (size_t i = 0, len = attrib.vertices.size(); i < len; i += 3) {
-		this->vertices.emplace_back(i, i + 1, i + 2);
-	}
-
-	tinyobj::shape_t shape = shapes[0];
-
-	// Loop over faces (polygon)
-	size_t index_offset = 0;
-	for (int fv : shape.mesh.num_face_vertices) {
-		std::vector<size_t> vertex_indices;
-		// Loop over vertices in the face
-		for (size_t v = 0; v < fv; v++) {
-			vertex_indices.emplace_back(shape.mesh.indices[index_offset + v].vertex_index);
-		}
-		// Tessellate face into triangles
-		this->tessellateFace(vertex_indices);
-		index_offset += fv;
-	}
-}
+) : Object3D(ambient_color, diffuse_color, specular_color, shininess),
+    mesh(mesh) {}
 
 bool ObjModel::doesRayIntersect(
 	const glm::vec3& origin,
@@ -68,33 +46,62 @@ bool ObjModel::doesRayIntersect(
 	glm::vec3* const& normal
 ) const
 {
-	*t = std::numeric_limits<float>::max();
+	return this->mesh.doesRayIntersect(origin, direction, t, normal);
+}
 
-	bool does_intersect = false;
+unsigned int ObjModel::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	return this->mesh.intersectPacket(packet, kernels);
+}
 
-	float temp_t;
-	glm::vec3 temp_normal;
-	// find nearest intersection point among triangles forming tessellation
-	for (const Triangle& tri : this->triangles) {
-		if (tri.doesRayIntersect(origin, direction, &temp_t, &temp_normal) && temp_t < *t) {
-			*t = temp_t;
-			*normal = temp_normal;
-			does_intersect = true;
-		}
-	}
+bool ObjModel::isBlockingRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max
+) const
+{
+	return this->mesh.isBlockingRay(origin, direction, t_max);
+}
 
-	return does_intersect;
+AABB ObjModel::getBounds() const
+{
+	return this->mesh.getBounds();
 }
 
-void ObjModel::tessellateFace(const std::vector<size_t>& vertex_indices)
+TriangleMesh ObjModel::loadMesh(const std::string& filename)
 {
-	// Triangle fan tessellation (TODO: smarter tessellation)
-	for (size_t i = 1, last = vertex_indices.size() - 1; i < last; i++) {
-		this->triangles.emplace_back(
-			&this->vertices[vertex_indices[0]],
-			&this->vertices[vertex_indices[i]],
-			&this->vertices[vertex_indices[i + 1]],
-			this
-		);
+	PROFILE_SCOPE(load_model);
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	MeshCache cache(filename);
+	TriangleMesh mesh;
+	if (cache.load(&mesh)) {
+		std::cout << "Loaded mesh for " << filename << " from " << cache.getFilename()
+			<< " in " << std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - start_time
+			).count() << " ms: " << mesh.getTriangleCount() << " triangles."
+			<< std::endl;
+		return mesh;
+	}
+
+	mesh = buildMesh(filename);
+	if (!cache.save(mesh)) {
+		std::cerr << "Couldn't write mesh cache " << cache.getFilename() << "."
+			<< std::endl;
 	}
+
+	const BVHBuildStats& stats = mesh.getBVH().getBuildStats();
+	std::cout << "Built BVH for " << filename << " in " << stats.build_milliseconds
+		<< " ms: " << stats.primitive_count << " triangles, " << stats.node_count
+		<< " nodes (" << stats.leaf_count << " leaves, max " << stats.max_leaf_size
+		<< " triangles per leaf), depth " << stats.max_depth << "." << std::endl;
+	std::cout << "Expected per ray: " << stats.expected_node_tests << " box tests, "
+		<< stats.expected_primitive_tests << " triangle tests (vs. "
+		<< stats.primitive_count << " without BVH)." << std::endl;
+	std::cout << "Mesh data: " << mesh.getMemoryUsage() / 1024 << " KiB ("
+		<< (double)mesh.getMemoryUsage() / mesh.getTriangleCount()
+		<< " bytes per triangle, including BVH)." << std::endl;
+	return mesh;
 }
@@ -5,23 +5,25 @@
 #include <string>
 #include <vector>
 
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/accel/TriangleMesh.hpp>
+
 #include "Object3D.hpp"
-#include "Triangle.hpp"
 
 // .obj model requirements:
-// * at least one shape (first shape will be used, others discarded)
+// * at least one face (faces of all shapes are used)
 // * specification of faces by vertices
 // * all other information will be ignored
 
 class ObjModel : public Object3D {
 private:
-	std::vector<glm::vec3> vertices;
-	std::vector<Triangle> triangles;
-	// populate this->vertices before calling tessellateFace!
-	void tessellateFace(const std::vector<size_t>& vertex_indices);
+	TriangleMesh mesh;
 public:
-	explicit ObjModel(
-		const std::string& filename,
+	// mesh can be shared with other ObjModels and MeshInstances (copying a
+	// TriangleMesh doesn't copy its triangles)
+	ObjModel(
+		const TriangleMesh& mesh,
 		const glm::vec3& ambient_color,
 		const glm::vec3& diffuse_color,
 		const glm::vec3& specular_color,
@@ -33,6 +35,19 @@ public:
 		float* const& t,
 		glm::vec3* const& normal
 	) const override;
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const override;
+	bool isBlockingRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) const override;
+	AABB getBounds() const override;
+	// loads the mesh of an .obj file from its MeshCache if up to date, otherwise
+	// parses and builds it (and caches it)
+	static TriangleMesh loadMesh(const std::string& filename);
 };
 
 
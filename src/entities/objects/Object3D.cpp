@@ -1,5 +1,9 @@
 #include <glm/glm.hpp>
 
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/entities/Material.hpp>
+
 #include "Object3D.hpp"
 
 Object3D::Object3D(
@@ -7,57 +11,90 @@ Object3D::Object3D(
 	const glm::vec3& diffuse_color,
 	const glm::vec3& specular_color,
 	const float& shininess
-) {
-	this->ambient_color = new glm::vec3(ambient_color);
-	this->diffuse_color = new glm::vec3(diffuse_color);
-	this->specular_color = new glm::vec3(specular_color);
-	this->shininess = shininess;
-	this->material_parent = nullptr;
-}
+) : material(ambient_color, diffuse_color, specular_color, shininess) {}
 
-Object3D::Object3D(const Object3D* const& material_parent)
+const Material& Object3D::getMaterial() const
 {
-	this->ambient_color = material_parent->ambient_color;
-	this->diffuse_color = material_parent->diffuse_color;
-	this->specular_color = material_parent->specular_color;
-	this->shininess = material_parent->shininess;
-	this->material_parent = material_parent;
+	return this->material;
 }
 
-Object3D::~Object3D()
-{
-	if (!this->material_parent) {
-		delete this->ambient_color;
-		delete this->diffuse_color;
-		delete this->specular_color;
-	}
+void Object3D::setOptics(
+	const float& reflectivity,
+	const float& transparency,
+	const float& refractive_index
+) {
+	this->material.reflectivity = reflectivity;
+	this->material.transparency = transparency;
+	this->material.refractive_index = refractive_index;
 }
 
 glm::vec3 Object3D::getAmbientColor() const
 {
-	return *this->ambient_color;
+	return this->material.ambient_color;
 }
 
 glm::vec3 Object3D::getDiffuseColor() const
 {
-	return *this->diffuse_color;
+	return this->material.diffuse_color;
 }
 
 glm::vec3 Object3D::getSpecularColor() const
 {
-	return *this->specular_color;
+	return this->material.specular_color;
 }
 
 float Object3D::getShininess() const
 {
-	return this->shininess;
+	return this->material.shininess;
+}
+
+bool Object3D::isBounded() const
+{
+	return true;
 }
 
 bool Object3D::isBlockingSegment(const glm::vec3& point_a, const glm::vec3& point_b) const
 {
 	glm::vec3 segment = point_b - point_a;
-	glm::vec3 direction = glm::normalize(segment);
+	// (not segment.length(), which is the number of vector components)
+	float segment_length = glm::length(segment);
+	return this->isBlockingRay(point_a, segment / segment_length, segment_length);
+}
+
+bool Object3D::isBlockingRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max
+) const
+{
 	float t;
 	glm::vec3 normal; // doesn't get used here
-	return this->doesRayIntersect(point_a, direction, &t, &normal) && t < segment.length();
+	return this->doesRayIntersect(origin, direction, &t, &normal) && t < t_max;
+}
+
+unsigned int Object3D::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels&
+) const
+{
+	unsigned int mask = 0;
+	float t;
+	glm::vec3 normal;
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		if (
+			(packet->lane_mask & (1u << lane)) &&
+			this->doesRayIntersect(
+				packet->getOrigin(lane),
+				packet->getDirection(lane),
+				&t,
+				&normal
+			) &&
+			t < packet->t[lane]
+		) {
+			packet->t[lane] = t;
+			packet->normals[lane] = normal;
+			mask |= 1u << lane;
+		}
+	}
+	return mask;
 }
@@ -3,15 +3,16 @@
 
 #include <glm/glm.hpp>
 
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/entities/Material.hpp>
+
 // abstract class
 
 class Object3D {
 private:
-	glm::vec3* ambient_color;
-	glm::vec3* diffuse_color;
-	glm::vec3* specular_color;
-	float shininess;
-	const Object3D* material_parent;
+	Material material;
 public:
 	Object3D(
 		const glm::vec3& ambient_color,
@@ -19,8 +20,14 @@ public:
 		const glm::vec3& specular_color,
 		const float& shininess
 	);
-	explicit Object3D(const Object3D* const& material_parent);
-	virtual ~Object3D();
+	virtual ~Object3D() = default;
+	const Material& getMaterial() const;
+	// see Material. Objects start out neither reflective nor transparent.
+	void setOptics(
+		const float& reflectivity,
+		const float& transparency,
+		const float& refractive_index
+	);
 	glm::vec3 getAmbientColor() const;
 	glm::vec3 getDiffuseColor() const;
 	glm::vec3 getSpecularColor() const;
@@ -34,6 +41,24 @@ public:
 		float* const& t,
 		glm::vec3* const& normal
 	) const = 0;
+	// Packet version of doesRayIntersect: for each lane of the packet whose ray hits
+	// this object closer than its closest hit so far, updates that lane's t and
+	// normal. Returns a mask of updated lanes (setting their object is left to the
+	// caller). By default, each lane is traced on its own with doesRayIntersect.
+	virtual unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const;
+	// true if the ray hits anything with t < t_max. Unlike doesRayIntersect this
+	// doesn't need to find the closest hit, so can stop at the first one found.
+	virtual bool isBlockingRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) const;
+	// unbounded objects (e.g. infinite planes) are kept out of the scene BVH
+	virtual bool isBounded() const;
+	virtual AABB getBounds() const = 0;
 };
 
 
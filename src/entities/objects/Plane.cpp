@@ -2,6 +2,10 @@
 #include <cmath>
 
 #include <src/constants.hpp>
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/profiling/Profiler.hpp>
 
 #include "Object3D.hpp"
 #include "Plane.hpp"
@@ -24,6 +28,8 @@ bool Plane::doesRayIntersect(
 	glm::vec3* const& normal
 ) const
 {
+	PROFILE_COUNT(plane_tests, 1);
+
 	*normal = this->normal;
 
 	// formula based on slides 11-12 at:
@@ -35,11 +41,37 @@ bool Plane::doesRayIntersect(
 
 	float normal_dot_direction = glm::dot(this->normal, direction);
 
-	// negative sign negated since camera looks down negative-Z axis
-	// (thanks https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/ray-triangle-intersection-geometric-solution
-	// for the tip)
-	// TODO: take look direction into account to handle general case
-	*t = (normal_dot_origin + normal_dot_position) / normal_dot_direction;
+	*t = (normal_dot_position - normal_dot_origin) / normal_dot_direction;
 
 	return *t >= t_threshold && !std::isnan(*t);
 }
+
+unsigned int Plane::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	PROFILE_COUNT(plane_tests, 1);
+	unsigned int mask = kernels.intersectPlane(
+		packet,
+		this->normal,
+		glm::dot(this->normal, this->position)
+	);
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		if (mask & (1u << lane)) {
+			packet->normals[lane] = this->normal;
+		}
+	}
+	return mask;
+}
+
+bool Plane::isBounded() const
+{
+	return false;
+}
+
+AABB Plane::getBounds() const
+{
+	// infinite, so no finite box can contain it
+	return AABB();
+}
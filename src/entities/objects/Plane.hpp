@@ -3,6 +3,10 @@
 
 #include <glm/glm.hpp>
 
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+
 #include "Object3D.hpp"
 #include "Triangle.hpp"
 
@@ -26,6 +30,12 @@ public:
 		float* const& t,
 		glm::vec3* const& normal
 	) const override;
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const override;
+	bool isBounded() const override;
+	AABB getBounds() const override;
 };
 
 
@@ -3,6 +3,10 @@
 #include <algorithm>
 
 #include <src/constants.hpp>
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/profiling/Profiler.hpp>
 
 #include "Object3D.hpp"
 #include "Sphere.hpp"
@@ -25,6 +29,8 @@ bool Sphere::doesRayIntersect(
 	glm::vec3* const& normal
 ) const
 {
+	PROFILE_COUNT(sphere_tests, 1);
+
 	// geometric solution based on explation at:
 	// https://www.scratchapixel.com/code.php?id=3&origin=/lessons/3d-basic-rendering/introduction-to-ray-tracing
 	// TODO: implement analytic solution based on quadratic formula (previous implementations produced undesired visual artifacts)
@@ -33,13 +39,19 @@ bool Sphere::doesRayIntersect(
 	glm::vec3 vec_to_sphere_center = this->position - origin;
 	// t corresponding to point lying on sphere's center axis
 	float t_center_axis = glm::dot(vec_to_sphere_center, direction);
-	if (t_center_axis < t_threshold) {
+	// (a ray starting inside the sphere, like one refracted into it, always hits
+	// its far side)
+	bool is_origin_inside = glm::dot(vec_to_sphere_center, vec_to_sphere_center) <
+		this->radius * this->radius;
+	if (t_center_axis < t_threshold && !is_origin_inside) {
 		// if the sphere center is too low we shouldn't declare an intersection
 		return false;
 	}
 	// the square of d, the distance from the sphere center to the cast ray
-	float d_squared =
-		glm::dot(vec_to_sphere_center, vec_to_sphere_center) - pow(t_center_axis, 2);
+	// (measured directly, rather than as the difference of two large squares,
+	// which loses most of its precision for distant spheres)
+	glm::vec3 center_to_ray = vec_to_sphere_center - direction * t_center_axis;
+	float d_squared = glm::dot(center_to_ray, center_to_ray);
 	if (d_squared > this->radius * this->radius) {
 		// if d squared is greater than the radius squared, that would push the ray
 		// outside the bounds of the sphere, so no intersection.
@@ -52,13 +64,61 @@ bool Sphere::doesRayIntersect(
 	// and the center axis
 	auto t_from_point_to_center_axis =
 		(float)sqrt(this->radius * this->radius - d_squared);
-	*t = std::min(
-		t_center_axis - t_from_point_to_center_axis,
-		t_center_axis + t_from_point_to_center_axis
-	);
+	// the near intersection, unless it's behind the origin
+	float t_near = t_center_axis - t_from_point_to_center_axis;
+	*t = t_near >= t_threshold ? t_near : t_center_axis + t_from_point_to_center_axis;
 
 	// compute normal pointing from sphere center to intersection point
 	*normal = glm::normalize((origin + direction * *t) - this->position);
 
 	return true;
 }
+
+unsigned int Sphere::intersectPacket(
+	RayPacket* const& packet,
+	const PacketKernels& kernels
+) const
+{
+	PROFILE_COUNT(sphere_tests, 1);
+	unsigned int mask = kernels.intersectSphere(packet, this->position, this->radius);
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		if (mask & (1u << lane)) {
+			packet->normals[lane] = glm::normalize(
+				(packet->getOrigin(lane) + packet->getDirection(lane) * packet->t[lane]) -
+					this->position
+			);
+		}
+	}
+	return mask;
+}
+
+bool Sphere::isBlockingRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t_max
+) const
+{
+	PROFILE_COUNT(sphere_tests, 1);
+	// same geometric solution as doesRayIntersect, minus the normal
+	glm::vec3 vec_to_sphere_center = this->position - origin;
+	float t_center_axis = glm::dot(vec_to_sphere_center, direction);
+	glm::vec3 center_to_ray = vec_to_sphere_center - direction * t_center_axis;
+	float d_squared = glm::dot(center_to_ray, center_to_ray);
+	if (d_squared > this->radius * this->radius) {
+		return false;
+	}
+	auto t_from_point_to_center_axis =
+		(float)sqrt(this->radius * this->radius - d_squared);
+	// either intersection point counts, so a ray starting inside the sphere is
+	// blocked by the far side
+	float t_near = t_center_axis - t_from_point_to_center_axis;
+	float t_far = t_center_axis + t_from_point_to_center_axis;
+	return (t_near >= t_threshold && t_near < t_max) ||
+		(t_far >= t_threshold && t_far < t_max);
+}
+
+AABB Sphere::getBounds() const
+{
+	glm::vec3 extent(this->radius, this->radius, this->radius);
+	return AABB(this->position - extent, this->position + extent);
+}
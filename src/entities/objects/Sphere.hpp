@@ -3,6 +3,10 @@
 
 #include <glm/glm.hpp>
 
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+
 #include "Object3D.hpp"
 
 class Sphere : public Object3D  {
@@ -24,6 +28,16 @@ public:
 		float* const& t,
 		glm::vec3* const& normal
 	) const override;
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const override;
+	bool isBlockingRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t_max
+	) const override;
+	AABB getBounds() const override;
 };
 
 
@@ -3,16 +3,19 @@
 
 #include <glm/glm.hpp>
 
+#include <src/accel/AABB.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+
 #include "Object3D.hpp"
 
 class Triangle : public Object3D  {
 private:
-	glm::vec3* vertex1;
-	glm::vec3* vertex2;
-	glm::vec3* vertex3;
+	glm::vec3 vertex1;
+	// vertex2 - vertex1 and vertex3 - vertex1, precomputed for the intersection test
+	glm::vec3 edge1_2;
+	glm::vec3 edge1_3;
 	glm::vec3 normal;
-	bool using_external_vertices;
-	void setNormal();
 public:
 	Triangle(
 		const glm::vec3& vertex1,
@@ -23,19 +26,17 @@ public:
 		const glm::vec3& specular_color,
 		const float& shininess
 	);
-	Triangle(
-		glm::vec3* vertex1,
-		glm::vec3* vertex2,
-		glm::vec3* vertex3,
-		Object3D* const& material_parent
-	);
-	~Triangle() override;
 	bool doesRayIntersect(
 		const glm::vec3& origin,
 		const glm::vec3& direction,
 		float* const& t,
 		glm::vec3* const& normal
 	) const override;
+	unsigned int intersectPacket(
+		RayPacket* const& packet,
+		const PacketKernels& kernels
+	) const override;
+	AABB getBounds() const override;
 };
 
 
@@ -2,84 +2,409 @@
 #include <vector>
 #include <limits>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 
 #include "entities/Light.hpp"
 #include "entities/objects/Object3D.hpp"
+#include "accel/SceneBVH.hpp"
+#include "accel/RayPacket.hpp"
+#include "profiling/Profiler.hpp"
+#include "constants.hpp"
+#include "hashBits.hpp"
+#include "getColorForRay.hpp"
+
+namespace {
+	// a reflected or refracted ray still to be traced, with the fraction of each
+	// channel of the color it finds which makes it into the pixel
+	struct SecondaryRay {
+		glm::vec3 origin;
+		glm::vec3 direction;
+		glm::vec3 weight;
+		unsigned int depth;
+	};
+
+	// Hash of the ray, for random choices which don't depend on which thread traces
+	// what, so renders come out the same every time
+	uint32_t getRayHash(const glm::vec3& origin, const glm::vec3& direction)
+	{
+		float components[6] = {
+			origin.x, origin.y, origin.z,
+			direction.x, direction.y, direction.z
+		};
+		uint32_t hash = 0;
+		for (const float& component : components) {
+			uint32_t bits;
+			std::memcpy(&bits, &component, sizeof(bits));
+			hash = mixBits(hash ^ bits);
+		}
+		return hash;
+	}
+
+	// Phong color of the surface hit along the ray at origin + direction * t, on its
+	// own (without anything it reflects or lets through), clamped to [0, 1]
+	glm::vec3 getSurfaceColor(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		const float& t,
+		const glm::vec3& normal,
+		const Object3D* const& illuminated_object,
+		const std::vector<Light>& lights,
+		const SceneBVH& scene,
+		const PacketKernels* const& packet_kernels
+	) {
+		glm::vec3 accumulated_color(0.0f, 0.0f, 0.0f);
+
+		glm::vec3 point = origin + direction * t;
+
+		glm::vec3 viewer_unit_vector = -direction;
+
+		// nudge shadow rays off the surface, on the side being viewed
+		glm::vec3 shadow_origin = point + normal *
+			(glm::dot(normal, viewer_unit_vector) < 0.0f ? -shadow_bias : shadow_bias);
+		// places the samples of area lights
+		uint32_t seed = getRayHash(shadow_origin, direction);
+
+		// Phong illumination model
+
+		for (const Light& light : lights) {
+			glm::vec3 light_position = light.getPosition();
+			float visibility =
+				getLightVisibility(light, shadow_origin, seed, scene, packet_kernels);
+			if (visibility > 0.0f) {
+				glm::vec3 light_unit_vector = glm::normalize(light_position - point);
+				float light_dot_normal = glm::dot(light_unit_vector, normal);
+				light_dot_normal = std::max(light_dot_normal, 0.0f); // clamp
+
+				glm::vec3 reflection_unit_vector =
+					2 * light_dot_normal * normal - light_unit_vector;
+				float reflection_dot_viewer = glm::dot(
+					reflection_unit_vector,
+					viewer_unit_vector
+				);
+				reflection_dot_viewer = std::max(reflection_dot_viewer, 0.0f); // clamp
+
+				accumulated_color += visibility * light.getColor() *
+					(
+						illuminated_object->getDiffuseColor() * light_dot_normal +
+							illuminated_object->getSpecularColor() *
+								float(pow(
+									reflection_dot_viewer,
+									illuminated_object->getShininess()
+								))
+					);
+			}
+		}
+
+		accumulated_color += illuminated_object->getAmbientColor();
+
+		// clamp to [0, 1]
+		accumulated_color.r = std::min(1.0f, accumulated_color.r);
+		accumulated_color.g = std::min(1.0f, accumulated_color.g);
+		accumulated_color.b = std::min(1.0f, accumulated_color.b);
+
+		return accumulated_color;
+	}
+
+	// adds the ray to the stack, unless it wouldn't add enough to the pixel to be
+	// worth tracing
+	void pushSecondaryRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		glm::vec3 weight,
+		const unsigned int& depth,
+		SecondaryRay* const& stack,
+		size_t* const& stack_size
+	) {
+		float contribution = std::max(weight.r, std::max(weight.g, weight.b));
+		if (contribution < min_ray_contribution) {
+			return;
+		}
+		if (contribution < roulette_contribution) {
+			float survival_chance = contribution / roulette_contribution;
+			// (picked by hashing the ray)
+			if (toUnitFloat(getRayHash(origin, direction)) >= survival_chance) {
+				return;
+			}
+			weight /= survival_chance;
+		}
+		stack[(*stack_size)++] = {origin, direction, weight, depth};
+	}
+
+	// adds the rays reflected and refracted where the ray hits a surface at point,
+	// split between as the surface's material says
+	void pushSecondaryRays(
+		const glm::vec3& point,
+		const glm::vec3& direction,
+		const glm::vec3& normal,
+		const Material& material,
+		const glm::vec3& weight,
+		const unsigned int& depth,
+		SecondaryRay* const& stack,
+		size_t* const& stack_size
+	) {
+		if (depth >= max_ray_depth) {
+			return;
+		}
+		SurfaceScattering scattering = getSurfaceScattering(direction, normal, material);
+
+		// refracted rays start just past the surface, reflected ones just before it
+		if (scattering.refracted > 0.0f) {
+			pushSecondaryRay(
+				point - scattering.facing_normal * shadow_bias,
+				scattering.refracted_direction,
+				weight * scattering.refracted,
+				depth + 1,
+				stack,
+				stack_size
+			);
+		}
+		if (scattering.reflected > 0.0f) {
+			pushSecondaryRay(
+				point + scattering.facing_normal * shadow_bias,
+				scattering.reflected_direction,
+				weight * scattering.reflected,
+				depth + 1,
+				stack,
+				stack_size
+			);
+		}
+	}
+}
+
+SurfaceScattering getSurfaceScattering(
+	const glm::vec3& direction,
+	const glm::vec3& normal,
+	const Material& material
+) {
+	SurfaceScattering scattering;
+	bool is_entering = glm::dot(direction, normal) < 0.0f;
+	scattering.facing_normal = is_entering ? normal : -normal;
+	float cos_incident = -glm::dot(direction, scattering.facing_normal);
+
+	scattering.reflected = material.reflectivity;
+	scattering.refracted = 0.0f;
+	if (material.transparency > 0.0f) {
+		float index = material.refractive_index;
+		// ratio of the refractive index on the side the ray comes from to that of
+		// the side it goes into
+		float eta = is_entering ? 1.0f / index : index;
+		float cos_transmitted_squared =
+			1.0f - eta * eta * (1.0f - cos_incident * cos_incident);
+		if (cos_transmitted_squared < 0.0f) {
+			// total internal reflection
+			scattering.reflected += material.transparency;
+		} else {
+			float cos_transmitted = (float)sqrt(cos_transmitted_squared);
+			// Schlick's approximation, with the angle on the outside of the surface
+			float r0 = (1.0f - index) / (1.0f + index);
+			r0 *= r0;
+			float cos_outside = is_entering ? cos_incident : cos_transmitted;
+			float fresnel = r0 + (1.0f - r0) * float(pow(1.0f - cos_outside, 5));
+			scattering.reflected += material.transparency * fresnel;
+			scattering.refracted = material.transparency * (1.0f - fresnel);
+			scattering.refracted_direction = glm::normalize(
+				eta * direction +
+					(eta * cos_incident - cos_transmitted) * scattering.facing_normal
+			);
+		}
+	}
+	scattering.reflected_direction = glm::normalize(
+		direction + 2.0f * cos_incident * scattering.facing_normal
+	);
+	return scattering;
+}
 
 glm::vec3 getColorForRay(
 	const glm::vec3& origin,
 	const glm::vec3& direction,
 	const std::vector<Light>& lights,
-	const std::vector<Object3D*>& scene_objects
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels
 ) {
-	glm::vec3 accumulated_color(0.0f, 0.0f, 0.0f);
-
-	bool does_intersect = false;
-
-	float t = std::numeric_limits<float>::max();
+	float t;
 	glm::vec3 normal;
 	Object3D* illuminated_object = nullptr;
 
-	float temp_t;
-	glm::vec3 temp_normal;
-	for (Object3D* const& object : scene_objects) {
-		if (object->doesRayIntersect(origin, direction, &temp_t, &temp_normal) && temp_t < t) {
-			t = temp_t;
-			normal = temp_normal;
-			illuminated_object = object;
-			does_intersect = true;
-		}
+	bool does_intersect;
+	{
+		PROFILE_SCOPE(intersect);
+		does_intersect =
+			scene.doesRayIntersect(origin, direction, &t, &normal, &illuminated_object);
 	}
-
 	if (!does_intersect) {
-		return accumulated_color;
+		return glm::vec3(0.0f, 0.0f, 0.0f);
 	}
 
-	glm::vec3 point = origin + direction * t;
+	return getColorForIntersection(
+		origin,
+		direction,
+		t,
+		normal,
+		illuminated_object,
+		lights,
+		scene,
+		packet_kernels
+	);
+}
 
-	glm::vec3 viewer_unit_vector = -direction;
+glm::vec3 getColorForIntersection(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t,
+	const glm::vec3& normal,
+	const Object3D* const& illuminated_object,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels
+) {
+	PROFILE_SCOPE(shade);
+	glm::vec3 color = getSurfaceColor(
+		origin,
+		direction,
+		t,
+		normal,
+		illuminated_object,
+		lights,
+		scene,
+		packet_kernels
+	);
 
-	// Phong illumination model
+	const Material& material = illuminated_object->getMaterial();
+	if (material.reflectivity == 0.0f && material.transparency == 0.0f) {
+		return color;
+	}
 
-	for (const Light& light : lights) {
-		glm::vec3 light_position = light.getPosition();
-		bool is_blocked = false;
-		for (size_t i = scene_objects.size(); !is_blocked && i--; ) {
-			if (scene_objects[i]->isBlockingSegment(point, light_position)) {
-				is_blocked = true;
-			}
-		}
-		if (!is_blocked) {
-			glm::vec3 light_unit_vector = glm::normalize(light_position - point);
-			float light_dot_normal = glm::dot(light_unit_vector, normal);
-			light_dot_normal = std::max(light_dot_normal, 0.0f); // clamp
-
-			glm::vec3 reflection_unit_vector =
-				2 * light_dot_normal * normal - light_unit_vector;
-			float reflection_dot_viewer = glm::dot(
-				reflection_unit_vector,
-				viewer_unit_vector
+	// The rest of the ray tree is walked depth first, off a stack rather than by
+	// recursion. Each ray's weight already includes every bounce leading up to it, so
+	// its surface's color goes straight into the pixel's, and nothing is kept of a ray
+	// once its children are pushed. At most one child waits on the stack at each
+	// depth, besides the one being traced.
+	SecondaryRay stack[2 * max_ray_depth];
+	size_t stack_size = 0;
+	pushSecondaryRays(
+		origin + direction * t,
+		direction,
+		normal,
+		material,
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		0,
+		stack,
+		&stack_size
+	);
+
+	RayCounts& counts = getThreadRayCounts();
+	while (stack_size > 0) {
+		SecondaryRay ray = stack[--stack_size];
+		counts.secondary_rays++;
+
+		float ray_t;
+		glm::vec3 ray_normal;
+		Object3D* ray_object = nullptr;
+		bool does_intersect;
+		{
+			PROFILE_SCOPE(intersect);
+			does_intersect = scene.doesRayIntersect(
+				ray.origin,
+				ray.direction,
+				&ray_t,
+				&ray_normal,
+				&ray_object
 			);
-			reflection_dot_viewer = std::max(reflection_dot_viewer, 0.0f); // clamp
-
-			accumulated_color += light.getColor() *
-				(
-					illuminated_object->getDiffuseColor() * light_dot_normal +
-						illuminated_object->getSpecularColor() *
-							float(pow(
-								reflection_dot_viewer,
-								illuminated_object->getShininess()
-							))
-				);
 		}
-	}
+		if (!does_intersect) {
+			continue;
+		}
 
-	accumulated_color += illuminated_object->getAmbientColor();
+		color += ray.weight * getSurfaceColor(
+			ray.origin,
+			ray.direction,
+			ray_t,
+			ray_normal,
+			ray_object,
+			lights,
+			scene,
+			packet_kernels
+		);
+		pushSecondaryRays(
+			ray.origin + ray.direction * ray_t,
+			ray.direction,
+			ray_normal,
+			ray_object->getMaterial(),
+			ray.weight,
+			ray.depth,
+			stack,
+			&stack_size
+		);
+	}
 
 	// clamp to [0, 1]
-	accumulated_color.r = std::min(1.0f, accumulated_color.r);
-	accumulated_color.g = std::min(1.0f, accumulated_color.g);
-	accumulated_color.b = std::min(1.0f, accumulated_color.b);
+	color.r = std::min(1.0f, color.r);
+	color.g = std::min(1.0f, color.g);
+	color.b = std::min(1.0f, color.b);
+
+	return color;
+}
 
-	return accumulated_color;
+RayCounts& getThreadRayCounts()
+{
+	static thread_local RayCounts counts;
+	return counts;
+}
+
+float getLightVisibility(
+	const Light& light,
+	const glm::vec3& point,
+	const uint32_t& seed,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels
+) {
+	RayCounts& counts = getThreadRayCounts();
+	unsigned int sample_count = light.getSampleCount();
+	if (sample_count == 1 || !packet_kernels) {
+		unsigned int visible_count = 0;
+		for (unsigned int i = 0; i < sample_count; i++) {
+			glm::vec3 light_point = light.getSamplePoint(point, i, seed);
+			if (!scene.isBlockingSegment(point, light_point)) {
+				visible_count++;
+			}
+		}
+		counts.shadow_rays += sample_count;
+		return (float)visible_count / sample_count;
+	}
+
+	unsigned int visible_count = 0;
+	unsigned int traced_count = 0;
+	for (unsigned int begin = 0; begin < sample_count; begin += RayPacket::size) {
+		unsigned int count = std::min(sample_count - begin, RayPacket::size);
+		RayPacket packet;
+		for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+			// lanes past the last sample repeat the first, but are left inactive
+			bool is_sample = lane < count;
+			glm::vec3 segment =
+				light.getSamplePoint(point, begin + (is_sample ? lane : 0), seed) - point;
+			float segment_length = glm::length(segment);
+			packet.setRay(lane, point, segment / segment_length, is_sample);
+			if (is_sample) {
+				// only what lies before the light blocks it
+				packet.t[lane] = segment_length;
+			}
+		}
+
+		unsigned int occluded_mask = scene.occludePacket(&packet, *packet_kernels);
+		unsigned int occluded_count = 0;
+		for (unsigned int lane = 0; lane < count; lane++) {
+			if (occluded_mask & (1u << lane)) {
+				occluded_count++;
+			}
+		}
+		visible_count += count - occluded_count;
+		traced_count += count;
+		if (begin == 0 && (occluded_count == 0 || occluded_count == count)) {
+			break;
+		}
+	}
+	counts.shadow_rays += traced_count;
+	return (float)visible_count / traced_count;
 }
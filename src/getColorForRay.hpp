@@ -3,15 +3,81 @@
 
 #include <glm/vec3.hpp>
 #include <vector>
+#include <cstdint>
 
 #include "entities/Light.hpp"
+#include "entities/Material.hpp"
 #include "entities/objects/Object3D.hpp"
+#include "accel/SceneBVH.hpp"
+#include "accel/packetKernels.hpp"
 
+// per-thread counts of the rays traced to color pixels. Renderer counts the primary
+// rays it traces, and the integrators a shadow ray for each light at each hit, and
+// every other ray they trace (reflected, refracted or bounced) as secondary.
+struct RayCounts {
+	unsigned long long primary_rays = 0;
+	unsigned long long shadow_rays = 0;
+	unsigned long long secondary_rays = 0;
+};
+
+RayCounts& getThreadRayCounts();
+
+// packet_kernels trace the shadow rays to area lights (see getLightVisibility)
 glm::vec3 getColorForRay(
 	const glm::vec3& origin,
 	const glm::vec3& direction,
 	const std::vector<Light>& lights,
-	const std::vector<Object3D*>& scene_objects
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels
+);
+
+// shades a hit already found along the ray, at point origin + direction * t, along
+// with whatever it reflects or lets through
+glm::vec3 getColorForIntersection(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t,
+	const glm::vec3& normal,
+	const Object3D* const& illuminated_object,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels
 );
 
+// How light arriving along direction at a surface is split between reflection and
+// refraction, by the surface's material and the Fresnel equations. The rest (if
+// any) is left to the surface's own color.
+struct SurfaceScattering {
+	// normal on the side the light comes from
+	glm::vec3 facing_normal;
+	float reflected;
+	float refracted;
+	glm::vec3 reflected_direction;
+	// only set if refracted isn't 0
+	glm::vec3 refracted_direction;
+};
+
+// works from either side of the surface, normal being the one it's defined with
+SurfaceScattering getSurfaceScattering(
+	const glm::vec3& direction,
+	const glm::vec3& normal,
+	const Material& material
+);
+
+// Fraction of light's samples (see Light) which nothing blocks from point (already
+// nudged off the surface it lies on), seed placing them. Samples are traced in
+// packets with packet_kernels, sharing their way through the scene's BVH, each lane
+// stopping at the first thing it hits. If those of the first packet (spread over
+// the whole light) either all reach it or none do, the rest are skipped, taking
+// point to be fully lit or fully in shadow. With packet_kernels nullptr, every
+// sample is traced on its own. Counts the shadow rays traced.
+float getLightVisibility(
+	const Light& light,
+	const glm::vec3& point,
+	const uint32_t& seed,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels
+);
+
+
 #endif //RAYTRACER_GETCOLORFORRAY_HPP
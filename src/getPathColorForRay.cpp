@@ -0,0 +1,239 @@
+#include <glm/vec3.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "entities/Light.hpp"
+#include "entities/objects/Object3D.hpp"
+#include "accel/SceneBVH.hpp"
+#include "render/SampleRandom.hpp"
+#include "profiling/Profiler.hpp"
+#include "constants.hpp"
+#include "getColorForRay.hpp"
+#include "getPathColorForRay.hpp"
+
+namespace {
+	// Light reaching the viewer from a surface at point straight from the lights,
+	// through diffuse_fraction of the surface's diffuse color and its specular
+	// highlight. A light's color is the light it shines on a surface facing it (so
+	// surfaces lit directly come out as they would with Phong shading). Area lights
+	// are sampled with new random numbers at every surface.
+	glm::vec3 getDirectLight(
+		const glm::vec3& point,
+		const glm::vec3& direction,
+		const glm::vec3& normal,
+		const Object3D* const& illuminated_object,
+		const float& diffuse_fraction,
+		const std::vector<Light>& lights,
+		const SceneBVH& scene,
+		const PacketKernels* const& packet_kernels,
+		SampleRandom* const& random
+	) {
+		glm::vec3 accumulated_color(0.0f, 0.0f, 0.0f);
+		glm::vec3 viewer_unit_vector = -direction;
+
+		// nudge shadow rays off the surface, on the side being viewed
+		glm::vec3 shadow_origin = point + normal *
+			(glm::dot(normal, viewer_unit_vector) < 0.0f ? -shadow_bias : shadow_bias);
+
+		glm::vec3 diffuse_color = illuminated_object->getDiffuseColor() * diffuse_fraction;
+		for (const Light& light : lights) {
+			glm::vec3 light_position = light.getPosition();
+			// (point lights have a single sample, which needs no random number)
+			uint32_t seed = light.getSampleCount() == 1 ? 0 : random->nextUint();
+			float visibility =
+				getLightVisibility(light, shadow_origin, seed, scene, packet_kernels);
+			if (visibility == 0.0f) {
+				continue;
+			}
+			glm::vec3 light_unit_vector = glm::normalize(light_position - point);
+			float light_dot_normal = std::max(glm::dot(light_unit_vector, normal), 0.0f);
+
+			glm::vec3 reflection_unit_vector =
+				2 * light_dot_normal * normal - light_unit_vector;
+			float reflection_dot_viewer = std::max(
+				glm::dot(reflection_unit_vector, viewer_unit_vector),
+				0.0f
+			);
+
+			accumulated_color += visibility * light.getColor() *
+				(
+					diffuse_color * light_dot_normal +
+						illuminated_object->getSpecularColor() *
+							float(pow(reflection_dot_viewer, illuminated_object->getShininess()))
+				);
+		}
+		return accumulated_color;
+	}
+
+	// unit vector on normal's side of a surface, picked with a chance in proportion
+	// to the cosine of its angle to normal (as light scattered by a diffuse surface
+	// is weighted)
+	glm::vec3 getCosineWeightedDirection(
+		const glm::vec3& normal,
+		SampleRandom* const& random
+	) {
+		float u = random->nextFloat();
+		float radius = (float)sqrt(u);
+		float angle = 2.0f * (float)M_PI * random->nextFloat();
+
+		// orthonormal basis around normal (Duff et al., "Building an Orthonormal
+		// Basis, Revisited")
+		float sign = normal.z >= 0.0f ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+
+		return glm::normalize(
+			tangent * (radius * (float)cos(angle)) +
+				bitangent * (radius * (float)sin(angle)) +
+				normal * (float)sqrt(std::max(1.0f - u, 0.0f))
+		);
+	}
+}
+
+glm::vec3 getPathColorForRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels,
+	SampleRandom* const& random
+) {
+	float t;
+	glm::vec3 normal;
+	Object3D* illuminated_object = nullptr;
+
+	bool does_intersect;
+	{
+		PROFILE_SCOPE(intersect);
+		does_intersect =
+			scene.doesRayIntersect(origin, direction, &t, &normal, &illuminated_object);
+	}
+	if (!does_intersect) {
+		return glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	return getPathColorForIntersection(
+		origin,
+		direction,
+		t,
+		normal,
+		illuminated_object,
+		lights,
+		scene,
+		packet_kernels,
+		random
+	);
+}
+
+glm::vec3 getPathColorForIntersection(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t,
+	const glm::vec3& normal,
+	const Object3D* const& illuminated_object,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels,
+	SampleRandom* const& random
+) {
+	PROFILE_SCOPE(shade);
+	glm::vec3 color(0.0f, 0.0f, 0.0f);
+	// fraction of each channel of the light found at the current hit which makes it
+	// back along the path to the pixel
+	glm::vec3 throughput(1.0f, 1.0f, 1.0f);
+
+	// the current hit
+	glm::vec3 ray_origin = origin;
+	glm::vec3 ray_direction = direction;
+	float ray_t = t;
+	glm::vec3 ray_normal = normal;
+	const Object3D* object = illuminated_object;
+
+	RayCounts& counts = getThreadRayCounts();
+	for (unsigned int depth = 0; ; depth++) {
+		glm::vec3 point = ray_origin + ray_direction * ray_t;
+		const Material& material = object->getMaterial();
+		SurfaceScattering scattering =
+			getSurfaceScattering(ray_direction, ray_normal, material);
+		// whatever isn't reflected or refracted is scattered diffusely
+		float diffuse_fraction = 1.0f - scattering.reflected - scattering.refracted;
+
+		color += throughput * getDirectLight(
+			point,
+			ray_direction,
+			ray_normal,
+			object,
+			diffuse_fraction,
+			lights,
+			scene,
+			packet_kernels,
+			random
+		);
+		if (depth == max_ray_depth) {
+			break;
+		}
+
+		// the path carries on one way, picked with a chance in proportion to the
+		// light it brings, so reflected and refracted paths keep their throughput
+		glm::vec3 next_origin;
+		glm::vec3 next_direction;
+		float choice = random->nextFloat();
+		if (choice < scattering.reflected) {
+			next_origin = point + scattering.facing_normal * shadow_bias;
+			next_direction = scattering.reflected_direction;
+		} else if (choice < scattering.reflected + scattering.refracted) {
+			next_origin = point - scattering.facing_normal * shadow_bias;
+			next_direction = scattering.refracted_direction;
+		} else {
+			next_origin = point + scattering.facing_normal * shadow_bias;
+			next_direction = getCosineWeightedDirection(scattering.facing_normal, random);
+			throughput *= material.diffuse_color;
+		}
+
+		// Russian roulette: once past the first few bounces, paths carrying little
+		// light are likely to end, and those that don't carry that much more
+		float max_throughput =
+			std::max(throughput.r, std::max(throughput.g, throughput.b));
+		if (max_throughput == 0.0f) {
+			break;
+		}
+		if (depth + 1 >= path_roulette_depth) {
+			float survival_chance = std::min(max_throughput, 0.95f);
+			if (random->nextFloat() >= survival_chance) {
+				break;
+			}
+			throughput /= survival_chance;
+		}
+
+		counts.secondary_rays++;
+		Object3D* next_object = nullptr;
+		bool does_intersect;
+		{
+			PROFILE_SCOPE(intersect);
+			does_intersect = scene.doesRayIntersect(
+				next_origin,
+				next_direction,
+				&ray_t,
+				&ray_normal,
+				&next_object
+			);
+		}
+		if (!does_intersect) {
+			break;
+		}
+		ray_origin = next_origin;
+		ray_direction = next_direction;
+		object = next_object;
+	}
+
+	// clamp to [0, 1]
+	color.r = std::min(1.0f, color.r);
+	color.g = std::min(1.0f, color.g);
+	color.b = std::min(1.0f, color.b);
+
+	return color;
+}
@@ -0,0 +1,48 @@
+#ifndef RAYTRACER_GETPATHCOLORFORRAY_HPP
+#define RAYTRACER_GETPATHCOLORFORRAY_HPP
+
+#include <glm/vec3.hpp>
+#include <vector>
+
+#include "entities/Light.hpp"
+#include "entities/objects/Object3D.hpp"
+#include "accel/SceneBVH.hpp"
+#include "accel/packetKernels.hpp"
+#include "render/SampleRandom.hpp"
+
+// Path tracing, the alternative to getColorForRay's Whitted-style shading. Rather
+// than branching at every reflective or transparent surface, a single path is
+// followed from each hit, picking at random whether it carries on reflected,
+// refracted or scattered diffusely (in proportion to how much light each brings),
+// and gathering light straight from the lights at each surface it reaches. So
+// light bounced between surfaces lights the scene, instead of the ambient colors
+// Phong shading makes do with (which path tracing leaves out).
+//
+// A single path is noisy, so a pixel needs many samples, each given its own random
+// numbers by random (see SampleRandom).
+
+glm::vec3 getPathColorForRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels,
+	SampleRandom* const& random
+);
+
+// follows the path on from a hit already found along the ray, at point
+// origin + direction * t
+glm::vec3 getPathColorForIntersection(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	const float& t,
+	const glm::vec3& normal,
+	const Object3D* const& illuminated_object,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	const PacketKernels* const& packet_kernels,
+	SampleRandom* const& random
+);
+
+
+#endif //RAYTRACER_GETPATHCOLORFORRAY_HPP
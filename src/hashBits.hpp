@@ -0,0 +1,28 @@
+#ifndef RAYTRACER_HASHBITS_HPP
+#define RAYTRACER_HASHBITS_HPP
+
+#include <cstdint>
+
+// For random choices made by hashing what they're made for (a pixel, a ray, a
+// sample) rather than drawing from a generator, so they don't depend on which
+// thread makes them or when, and renders come out the same every time.
+
+// scrambles the bits of value (the 32 bit finalizer from MurmurHash3)
+inline uint32_t mixBits(uint32_t value)
+{
+	value ^= value >> 16;
+	value *= 0x85ebca6bu;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35u;
+	value ^= value >> 16;
+	return value;
+}
+
+// in [0, 1), from the top 24 bits of bits (which a float holds exactly)
+inline float toUnitFloat(const uint32_t& bits)
+{
+	return (bits >> 8) / 16777216.0f;
+}
+
+
+#endif //RAYTRACER_HASHBITS_HPP
@@ -0,0 +1,24 @@
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <stdexcept>
+
+#include "hashFile.hpp"
+
+uint64_t hashFile(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open " + filename + " for hashing.");
+	}
+
+	uint64_t hash = 14695981039346656037ull;
+	char buffer[1 << 16];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+		for (std::streamsize i = 0, len = file.gcount(); i < len; i++) {
+			hash ^= (unsigned char)buffer[i];
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
@@ -0,0 +1,12 @@
+#ifndef RAYTRACER_HASHFILE_HPP
+#define RAYTRACER_HASHFILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+// 64-bit FNV-1a hash of a file's contents.
+// Throws std::runtime_error if it can't be read.
+uint64_t hashFile(const std::string& filename);
+
+#endif //RAYTRACER_HASHFILE_HPP
@@ -0,0 +1,481 @@
+#include <glm/glm.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+#include "parseFloat.hpp"
+#include "loadObj.hpp"
+
+namespace fs = boost::filesystem;
+namespace ipc = boost::interprocess;
+
+namespace {
+	// chunks are at least this big, so small files aren't split up for nothing
+	const size_t min_chunk_size = 1 << 18;
+	// ...and there are this many per thread, so threads which finish theirs early
+	// can take on more
+	const size_t chunks_per_thread = 4;
+
+	struct Chunk {
+		const char* begin;
+		const char* end;
+		// counted by the first pass
+		size_t line_count = 0;
+		size_t vertex_count = 0;
+		size_t normal_count = 0;
+		size_t texture_coordinate_count = 0;
+		size_t face_count = 0;
+		size_t triangle_count = 0;
+		bool has_normal_indices = false;
+		bool has_texture_coordinate_indices = false;
+		// totals over the chunks before this one, so where its elements go in the
+		// merged arrays
+		size_t first_line = 0;
+		size_t first_vertex = 0;
+		size_t first_normal = 0;
+		size_t first_texture_coordinate = 0;
+		size_t first_triangle = 0;
+		// set if parsing the chunk failed
+		std::string error;
+	};
+
+	// one corner of a face, as indices into the merged arrays
+	struct FaceCorner {
+		uint32_t vertex;
+		uint32_t normal;
+		uint32_t texture_coordinate;
+	};
+
+	enum class RecordType {
+		vertex,
+		normal,
+		texture_coordinate,
+		face,
+		other
+	};
+
+	// calls function(line_begin, line_end) for each line in chunk
+	template <typename LineFunction>
+	void forEachLine(const Chunk& chunk, LineFunction function)
+	{
+		const char* line = chunk.begin;
+		while (line < chunk.end) {
+			const char* line_end =
+				(const char*)std::memchr(line, '\n', chunk.end - line);
+			if (!line_end) {
+				line_end = chunk.end;
+			}
+			function(line, line_end);
+			line = line_end + 1;
+		}
+	}
+
+	// reads the keyword at the start of a line, leaving *cursor just after it
+	RecordType readRecordType(const char** const& cursor, const char* const& line_end)
+	{
+		const char* keyword = skipSpaces(*cursor, line_end);
+		const char* keyword_end = findTokenEnd(keyword, line_end);
+		*cursor = keyword_end;
+		size_t length = keyword_end - keyword;
+		if (length == 1 && keyword[0] == 'v') {
+			return RecordType::vertex;
+		}
+		if (length == 1 && keyword[0] == 'f') {
+			return RecordType::face;
+		}
+		if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+			return RecordType::normal;
+		}
+		if (length == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+			return RecordType::texture_coordinate;
+		}
+		return RecordType::other;
+	}
+
+	// first pass: counts the elements each record in the chunk adds, and the face
+	// corners referring to normals or texture coordinates
+	void countRecords(Chunk* const& chunk)
+	{
+		forEachLine(*chunk, [&](const char* cursor, const char* const& line_end) {
+			chunk->line_count++;
+			switch (readRecordType(&cursor, line_end)) {
+				case RecordType::vertex:
+					chunk->vertex_count++;
+					break;
+				case RecordType::normal:
+					chunk->normal_count++;
+					break;
+				case RecordType::texture_coordinate:
+					chunk->texture_coordinate_count++;
+					break;
+				case RecordType::face: {
+					size_t corner_count = 0;
+					while ((cursor = skipSpaces(cursor, line_end)) < line_end) {
+						const char* token_end = findTokenEnd(cursor, line_end);
+						const char* first_slash = (const char*)std::memchr(
+							cursor,
+							'/',
+							token_end - cursor
+						);
+						if (first_slash) {
+							// v/vt, v/vt/vn or v//vn
+							const char* second_slash = (const char*)std::memchr(
+								first_slash + 1,
+								'/',
+								token_end - first_slash - 1
+							);
+							if (second_slash) {
+								chunk->has_normal_indices = true;
+							}
+							if (!second_slash || second_slash > first_slash + 1) {
+								chunk->has_texture_coordinate_indices = true;
+							}
+						}
+						corner_count++;
+						cursor = token_end;
+					}
+					chunk->face_count++;
+					if (corner_count >= 3) {
+						chunk->triangle_count += corner_count - 2;
+					}
+					break;
+				}
+				case RecordType::other:
+					break;
+			}
+		});
+	}
+
+	// parses an integer at *cursor, stopping at the first character which isn't
+	// part of it
+	bool parseIndex(
+		const char** const& cursor,
+		const char* const& end,
+		long long* const& index
+	) {
+		const char* c = *cursor;
+		bool is_negative = c < end && *c == '-';
+		if (is_negative) {
+			c++;
+		}
+		long long value = 0;
+		const char* digits = c;
+		for (; c < end && isDigit(*c); c++) {
+			// big enough to be out of range, without overflowing
+			value = std::min(value * 10 + (*c - '0'), 1ll << 40);
+		}
+		if (c == digits) {
+			return false;
+		}
+		*index = is_negative ? -value : value;
+		*cursor = c;
+		return true;
+	}
+
+	// .obj indices start at 1, and negative ones count back from the last element
+	// defined so far
+	bool resolveIndex(
+		long long index,
+		size_t defined_count,
+		size_t total_count,
+		uint32_t* const& resolved
+	) {
+		long long position;
+		if (index > 0) {
+			position = index - 1;
+		} else if (index < 0) {
+			position = (long long)defined_count + index;
+		} else {
+			return false;
+		}
+		if (position < 0 || (size_t)position >= total_count) {
+			return false;
+		}
+		*resolved = (uint32_t)position;
+		return true;
+	}
+
+	// second pass: parses the chunk's records into their place in *mesh
+	void parseRecords(
+		Chunk* const& chunk,
+		const std::string& filename,
+		ObjMesh* const& mesh
+	) {
+		size_t line_number = chunk->first_line;
+		size_t vertex_count = chunk->first_vertex;
+		size_t normal_count = chunk->first_normal;
+		size_t texture_coordinate_count = chunk->first_texture_coordinate;
+		size_t triangle_index = chunk->first_triangle * 3;
+		bool has_normal_indices = !mesh->triangle_normal_indices.empty();
+		bool has_texture_coordinate_indices =
+			!mesh->triangle_texture_coordinate_indices.empty();
+		std::vector<FaceCorner> corners;
+
+		auto fail = [&](const std::string& message) {
+			throw std::runtime_error(
+				filename + ":" + std::to_string(line_number) + ": " + message
+			);
+		};
+
+		forEachLine(*chunk, [&](const char* cursor, const char* const& line_end) {
+			line_number++;
+			switch (readRecordType(&cursor, line_end)) {
+				case RecordType::vertex: {
+					glm::vec3& vertex = mesh->vertices[vertex_count++];
+					// any w or vertex color which follows is ignored
+					if (
+						!parseFloat(&cursor, line_end, &vertex.x) ||
+						!parseFloat(&cursor, line_end, &vertex.y) ||
+						!parseFloat(&cursor, line_end, &vertex.z)
+					) {
+						fail("Vertex needs three coordinates.");
+					}
+					break;
+				}
+				case RecordType::normal: {
+					glm::vec3& normal = mesh->normals[normal_count++];
+					if (
+						!parseFloat(&cursor, line_end, &normal.x) ||
+						!parseFloat(&cursor, line_end, &normal.y) ||
+						!parseFloat(&cursor, line_end, &normal.z)
+					) {
+						fail("Normal needs three coordinates.");
+					}
+					break;
+				}
+				case RecordType::texture_coordinate: {
+					glm::vec2& texture_coordinate =
+						mesh->texture_coordinates[texture_coordinate_count++];
+					if (!parseFloat(&cursor, line_end, &texture_coordinate.x)) {
+						fail("Texture coordinate needs at least one coordinate.");
+					}
+					if (!parseFloat(&cursor, line_end, &texture_coordinate.y)) {
+						texture_coordinate.y = 0.0f;
+					}
+					break;
+				}
+				case RecordType::face: {
+					corners.clear();
+					while ((cursor = skipSpaces(cursor, line_end)) < line_end) {
+						const char* token_end = findTokenEnd(cursor, line_end);
+						FaceCorner corner = {0, ObjMesh::no_index, ObjMesh::no_index};
+						long long index;
+						if (
+							!parseIndex(&cursor, token_end, &index) ||
+							!resolveIndex(
+								index,
+								vertex_count,
+								mesh->vertices.size(),
+								&corner.vertex
+							)
+						) {
+							fail("Face refers to a missing vertex.");
+						}
+						if (cursor < token_end && *cursor == '/') {
+							cursor++;
+							if (cursor < token_end && *cursor != '/') {
+								if (
+									!parseIndex(&cursor, token_end, &index) ||
+									!resolveIndex(
+										index,
+										texture_coordinate_count,
+										mesh->texture_coordinates.size(),
+										&corner.texture_coordinate
+									)
+								) {
+									fail("Face refers to a missing texture coordinate.");
+								}
+							}
+							if (cursor < token_end && *cursor == '/') {
+								cursor++;
+								if (
+									!parseIndex(&cursor, token_end, &index) ||
+									!resolveIndex(
+										index,
+										normal_count,
+										mesh->normals.size(),
+										&corner.normal
+									)
+								) {
+									fail("Face refers to a missing normal.");
+								}
+							}
+						}
+						if (cursor != token_end) {
+							fail("Malformed face corner.");
+						}
+						corners.push_back(corner);
+					}
+
+					// triangle fan tessellation (TODO: smarter tessellation)
+					for (size_t i = 1; i + 1 < corners.size(); i++) {
+						const FaceCorner* triangle[3] = {
+							&corners[0],
+							&corners[i],
+							&corners[i + 1]
+						};
+						for (const FaceCorner* corner : triangle) {
+							mesh->triangle_indices[triangle_index] = corner->vertex;
+							if (has_normal_indices) {
+								mesh->triangle_normal_indices[triangle_index] = corner->normal;
+							}
+							if (has_texture_coordinate_indices) {
+								mesh->triangle_texture_coordinate_indices[triangle_index] =
+									corner->texture_coordinate;
+							}
+							triangle_index++;
+						}
+					}
+					break;
+				}
+				case RecordType::other:
+					break;
+			}
+		});
+	}
+
+	// runs function(chunk) for each chunk on thread_count threads, then throws the
+	// error of the first chunk which failed, if any did
+	template <typename ChunkFunction>
+	void forEachChunk(
+		std::vector<Chunk>* const& chunks,
+		unsigned int thread_count,
+		ChunkFunction function
+	) {
+		std::atomic<size_t> next_chunk(0);
+		auto work = [&]() {
+			size_t i;
+			while ((i = next_chunk++) < chunks->size()) {
+				try {
+					function(&(*chunks)[i]);
+				} catch (const std::runtime_error& error) {
+					(*chunks)[i].error = error.what();
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < thread_count; i++) {
+			threads.emplace_back(work);
+		}
+		work();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		for (const Chunk& chunk : *chunks) {
+			if (!chunk.error.empty()) {
+				throw std::runtime_error(chunk.error);
+			}
+		}
+	}
+}
+
+ObjMesh loadObj(const std::string& filename, unsigned int thread_count)
+{
+	if (thread_count == 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	ObjMesh mesh;
+	boost::system::error_code error;
+	uint64_t file_size = fs::file_size(filename, error);
+	if (error) {
+		throw std::runtime_error("Failed to open " + filename + ".");
+	}
+	if (file_size == 0) {
+		// which can't be mapped
+		return mesh;
+	}
+	ipc::mapped_region region;
+	try {
+		ipc::file_mapping file(filename.c_str(), ipc::read_only);
+		region = ipc::mapped_region(file, ipc::read_only);
+	} catch (const ipc::interprocess_exception&) {
+		throw std::runtime_error("Failed to open " + filename + ".");
+	}
+	const char* data = (const char*)region.get_address();
+	const char* data_end = data + region.get_size();
+
+	// split at the first line break after each evenly spaced point
+	size_t chunk_count = std::max(
+		(size_t)1,
+		std::min(
+			thread_count * chunks_per_thread,
+			region.get_size() / min_chunk_size
+		)
+	);
+	std::vector<Chunk> chunks(chunk_count);
+	const char* chunk_begin = data;
+	for (size_t i = 0; i < chunk_count; i++) {
+		const char* chunk_end = data_end;
+		if (i + 1 < chunk_count) {
+			chunk_end = std::max(
+				chunk_begin,
+				data + region.get_size() * (i + 1) / chunk_count
+			);
+			chunk_end =
+				(const char*)std::memchr(chunk_end, '\n', data_end - chunk_end);
+			chunk_end = chunk_end ? chunk_end + 1 : data_end;
+		}
+		chunks[i].begin = chunk_begin;
+		chunks[i].end = chunk_end;
+		chunk_begin = chunk_end;
+	}
+
+	forEachChunk(&chunks, thread_count, countRecords);
+
+	size_t triangle_count = 0;
+	bool has_normal_indices = false;
+	bool has_texture_coordinate_indices = false;
+	size_t line_count = 0;
+	size_t vertex_count = 0;
+	size_t normal_count = 0;
+	size_t texture_coordinate_count = 0;
+	for (Chunk& chunk : chunks) {
+		chunk.first_line = line_count;
+		chunk.first_vertex = vertex_count;
+		chunk.first_normal = normal_count;
+		chunk.first_texture_coordinate = texture_coordinate_count;
+		chunk.first_triangle = triangle_count;
+		line_count += chunk.line_count;
+		vertex_count += chunk.vertex_count;
+		normal_count += chunk.normal_count;
+		texture_coordinate_count += chunk.texture_coordinate_count;
+		triangle_count += chunk.triangle_count;
+		mesh.face_count += chunk.face_count;
+		has_normal_indices = has_normal_indices || chunk.has_normal_indices;
+		has_texture_coordinate_indices =
+			has_texture_coordinate_indices || chunk.has_texture_coordinate_indices;
+	}
+	if (std::max(std::max(vertex_count, normal_count), texture_coordinate_count) >=
+		ObjMesh::no_index) {
+		throw std::runtime_error(filename + " has too many elements to index.");
+	}
+
+	mesh.vertices.resize(vertex_count);
+	mesh.normals.resize(normal_count);
+	mesh.texture_coordinates.resize(texture_coordinate_count);
+	mesh.triangle_indices.resize(triangle_count * 3);
+	if (has_normal_indices) {
+		mesh.triangle_normal_indices.resize(triangle_count * 3);
+	}
+	if (has_texture_coordinate_indices) {
+		mesh.triangle_texture_coordinate_indices.resize(triangle_count * 3);
+	}
+
+	forEachChunk(&chunks, thread_count, [&](Chunk* const& chunk) {
+		parseRecords(chunk, filename, &mesh);
+	});
+
+	return mesh;
+}
@@ -0,0 +1,38 @@
+#ifndef RAYTRACER_LOADOBJ_HPP
+#define RAYTRACER_LOADOBJ_HPP
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+// Geometry read from an .obj file, with the faces of every object and group in
+// it merged into one indexed mesh.
+struct ObjMesh {
+	// stands in for a normal or texture coordinate a face corner didn't give
+	static const uint32_t no_index = 0xffffffff;
+
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texture_coordinates;
+	// faces are fan tessellated, and each consecutive three entries index the
+	// vertices of one triangle
+	std::vector<uint32_t> triangle_indices;
+	// in step with triangle_indices, indexing normals and texture_coordinates.
+	// Empty if no face gives any.
+	std::vector<uint32_t> triangle_normal_indices;
+	std::vector<uint32_t> triangle_texture_coordinate_indices;
+	size_t face_count = 0;
+};
+
+// Reads the v, vn, vt and f records of an .obj file (everything else, such as
+// materials and smoothing groups, is skipped). The file is split into chunks at
+// line boundaries, which are parsed on thread_count threads (0 for one per
+// hardware thread) straight into their place in the merged arrays.
+//
+// Throws std::runtime_error if the file can't be read, or a record is malformed
+// or refers to an element that doesn't exist.
+ObjMesh loadObj(const std::string& filename, unsigned int thread_count = 0);
+
+#endif //RAYTRACER_LOADOBJ_HPP
@@ -1,15 +1,20 @@
 #include <glm/glm.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/algorithm/string.hpp>
-#include <boost/variant.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
 
 #include <string>
 #include <vector>
-#include <fstream>
-#include <cstdio>
+#include <map>
 #include <iostream>
 #include <algorithm>
-#include <map>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
 #include "entities/Camera.hpp"
 #include "entities/Light.hpp"
@@ -18,56 +23,164 @@
 #include "entities/objects/Plane.hpp"
 #include "entities/objects/Triangle.hpp"
 #include "entities/objects/ObjModel.hpp"
+#include "entities/objects/MeshInstance.hpp"
+#include "accel/TriangleMesh.hpp"
+#include "profiling/Profiler.hpp"
 #include "constants.hpp"
+#include "parseFloat.hpp"
 #include "loadScene.hpp"
 
 namespace fs = boost::filesystem;
+namespace ipc = boost::interprocess;
 
 namespace scl {
-	typedef boost::variant<glm::vec3, float> scene_attribute;
-
-	static std::string v1 = "v1";
-	static std::string v2 = "v2";
-	static std::string v3 = "v3";
-	static std::string amb = "amb";
-	static std::string dif = "dif";
-	static std::string spe = "spe";
-	static std::string shi = "shi";
-	static std::string fov = "fov";
-	static std::string f = "f";
-	static std::string a = "a";
-	static std::string rad = "rad";
-	static std::string pos = "pos";
-	static std::string nor = "nor";
-	static std::string col = "col";
-
-	bool isFloatAttribute(const std::string& fieldname)
-	{
-		static std::vector<std::string> names = {fov, f, a, rad, shi};
-		return std::find(names.begin(), names.end(), fieldname) != names.end();
-	}
+	// every attribute an entity can have, each entity type reading its own subset
+	// of them (see readSceneAttributes)
+	struct SceneAttributes {
+		glm::vec3 v1;
+		glm::vec3 v2;
+		glm::vec3 v3;
+		glm::vec3 amb;
+		glm::vec3 dif;
+		glm::vec3 spe;
+		glm::vec3 pos;
+		glm::vec3 nor;
+		glm::vec3 col;
+		glm::vec3 rot;
+		glm::vec3 sca;
+		glm::vec3 dir;
+		glm::vec3 up;
+		glm::vec3 e1;
+		glm::vec3 e2;
+		float shi;
+		float fov;
+		float f;
+		float a;
+		float rad;
+		// optional for every object, which is otherwise neither reflective nor
+		// transparent
+		float ref = 0.0f;
+		float tra = 0.0f;
+		float ior = 1.0f;
+		// optional for area lights
+		float samples = 16.0f;
+	};
 
-	std::string
-	getTrimmedLineFromFile(std::ifstream* const& file, int* const& line_number)
-	{
-		std::string line;
-		std::getline(*file, line);
-		(*line_number)++;
-		return boost::trim_copy(line);
-	}
+	// name of a field, and the attribute its value is read into (exactly one of
+	// vector and number is set)
+	struct SceneField {
+		const char* name;
+		glm::vec3 SceneAttributes::* vector;
+		float SceneAttributes::* number;
+	};
 
-	std::string getTrimmedSubstring(
-		const std::string& str,
-		const unsigned long& pos,
-		const unsigned long& n
-	)
-	{
-		return boost::trim_copy(str.substr(pos, n));
-	}
+	static const SceneField v1 = {"v1", &SceneAttributes::v1, nullptr};
+	static const SceneField v2 = {"v2", &SceneAttributes::v2, nullptr};
+	static const SceneField v3 = {"v3", &SceneAttributes::v3, nullptr};
+	static const SceneField amb = {"amb", &SceneAttributes::amb, nullptr};
+	static const SceneField dif = {"dif", &SceneAttributes::dif, nullptr};
+	static const SceneField spe = {"spe", &SceneAttributes::spe, nullptr};
+	static const SceneField shi = {"shi", nullptr, &SceneAttributes::shi};
+	static const SceneField fov = {"fov", nullptr, &SceneAttributes::fov};
+	static const SceneField f = {"f", nullptr, &SceneAttributes::f};
+	static const SceneField a = {"a", nullptr, &SceneAttributes::a};
+	static const SceneField rad = {"rad", nullptr, &SceneAttributes::rad};
+	static const SceneField pos = {"pos", &SceneAttributes::pos, nullptr};
+	static const SceneField nor = {"nor", &SceneAttributes::nor, nullptr};
+	static const SceneField col = {"col", &SceneAttributes::col, nullptr};
+	static const SceneField rot = {"rot", &SceneAttributes::rot, nullptr};
+	static const SceneField sca = {"sca", &SceneAttributes::sca, nullptr};
+	static const SceneField dir = {"dir", &SceneAttributes::dir, nullptr};
+	static const SceneField up = {"up", &SceneAttributes::up, nullptr};
+	static const SceneField ref = {"ref", nullptr, &SceneAttributes::ref};
+	static const SceneField tra = {"tra", nullptr, &SceneAttributes::tra};
+	static const SceneField ior = {"ior", nullptr, &SceneAttributes::ior};
+	static const SceneField e1 = {"e1", &SceneAttributes::e1, nullptr};
+	static const SceneField e2 = {"e2", &SceneAttributes::e2, nullptr};
+	static const SceneField samples = {"samples", nullptr, &SceneAttributes::samples};
+
+	// Reads a scene file a line at a time, straight out of the mapped file, so
+	// lines are never copied.
+	class SceneReader {
+	private:
+		std::string filename;
+		ipc::mapped_region region;
+		const char* cursor;
+		const char* end;
+		int line_number;
+	public:
+		explicit SceneReader(const std::string& filename)
+			: filename(filename), cursor(nullptr), end(nullptr), line_number(0)
+		{
+			boost::system::error_code error;
+			uint64_t file_size = fs::file_size(filename, error);
+			if (error) {
+				throw std::runtime_error("Could not open scene file '" + filename + "'.");
+			}
+			if (file_size == 0) {
+				// which can't be mapped, and reads as all empty lines
+				return;
+			}
+			try {
+				ipc::file_mapping file(filename.c_str(), ipc::read_only);
+				this->region = ipc::mapped_region(file, ipc::read_only);
+			} catch (const ipc::interprocess_exception&) {
+				throw std::runtime_error("Could not open scene file '" + filename + "'.");
+			}
+			this->cursor = (const char*)this->region.get_address();
+			this->end = this->cursor + this->region.get_size();
+		}
+
+		// next line, with surrounding whitespace trimmed. Lines past the end of the
+		// file read as empty.
+		boost::string_ref readLine()
+		{
+			this->line_number++;
+			const char* line = this->cursor;
+			const char* line_end = this->cursor;
+			if (this->cursor < this->end) {
+				line_end = (const char*)std::memchr(line, '\n', this->end - line);
+				if (!line_end) {
+					line_end = this->end;
+				}
+				this->cursor = std::min(line_end + 1, this->end);
+			}
+			while (line < line_end && std::isspace((unsigned char)*line)) {
+				line++;
+			}
+			while (line_end > line && std::isspace((unsigned char)*(line_end - 1))) {
+				line_end--;
+			}
+			return boost::string_ref(line, line_end - line);
+		}
+
+		// next line, as readLine would return it, without moving past it
+		boost::string_ref peekLine()
+		{
+			const char* cursor = this->cursor;
+			boost::string_ref line = this->readLine();
+			this->cursor = cursor;
+			this->line_number--;
+			return line;
+		}
+
+		const std::string& getFilename() const
+		{
+			return this->filename;
+		}
 
-	std::string getTrimmedSubstring(const std::string& str, const unsigned long& pos)
+		int getLineNumber() const
+		{
+			return this->line_number;
+		}
+	};
+
+	// models are read from the models directory sitting alongside the directory
+	// containing the scene file (like the scenes and models directories here)
+	fs::path getModelsDir(const std::string& scene_filename)
 	{
-		return boost::trim_copy(str.substr(pos));
+		return fs::absolute(fs::path(scene_filename)).parent_path().parent_path() /
+			models_dir.filename();
 	}
 
 	std::runtime_error scenefileFieldError(
@@ -119,51 +232,149 @@ namespace scl {
 		return scenefileFieldError(fieldname, filename, line_number, "deformed");
 	}
 
-	void readSceneAttributes(
-		const std::vector<std::string>& fieldnames,
-		const std::string& filename,
-		std::map<std::string, scene_attribute>* const& scene_attributes,
-		std::ifstream* const& scenefile,
-		int* const& line_number
+	// gives object the reflectivity, transparency and refractive index read for it,
+	// once they're checked to make sense
+	void setOptics(
+		const SceneAttributes& scene_attributes,
+		Object3D* const& object,
+		const SceneReader& scenefile
+	) {
+		const std::string& filename = scenefile.getFilename();
+		int line_number = scenefile.getLineNumber();
+		if (scene_attributes.ref < 0.0f || scene_attributes.ref > 1.0f) {
+			throw deformedFieldError("ref", filename, line_number);
+		}
+		// (reflected and transmitted light can't add up to more than came in)
+		if (
+			scene_attributes.tra < 0.0f ||
+			scene_attributes.ref + scene_attributes.tra > 1.0f
+		) {
+			throw deformedFieldError("tra", filename, line_number);
+		}
+		if (!(scene_attributes.ior > 0.0f)) {
+			throw deformedFieldError("ior", filename, line_number);
+		}
+		object->setOptics(scene_attributes.ref, scene_attributes.tra, scene_attributes.ior);
+	}
+
+	// the shadow ray sample count read for an area light, once it's checked to be a
+	// whole number from 1 to 65536
+	unsigned int getSampleCount(
+		const SceneAttributes& scene_attributes,
+		const SceneReader& scenefile
+	) {
+		float samples = scene_attributes.samples;
+		if (!(samples >= 1.0f && samples <= 65536.0f) || samples != std::floor(samples)) {
+			throw deformedFieldError(
+				"samples",
+				scenefile.getFilename(),
+				scenefile.getLineNumber()
+			);
+		}
+		return (unsigned int)samples;
+	}
+
+	// reads the (optionally quoted) .obj filename on the line after 'model' or
+	// 'instance'
+	std::string readModelFilename(
+		SceneReader* const& scenefile,
+		const std::string& scene_filename
 	) {
-		// for holding onto data while it's being parsed
-		std::string temp;
+		boost::string_ref obj_filename = scenefile->readLine();
+		// get rid of quotation marks
+		if (
+			obj_filename.size() >= 2 &&
+			obj_filename.front() == '"' &&
+			obj_filename.back() == '"'
+		) {
+			obj_filename = obj_filename.substr(1, obj_filename.size() - 2);
+		}
+		return (getModelsDir(scene_filename) / obj_filename.to_string()).string();
+	}
 
-		// each will be marked true when corresponding lines are read from file
-		std::map<std::string, bool> fields_collected;
-		for (const std::string& fieldname : fieldnames) {
-			fields_collected[fieldname] = false;
+	// each .obj file is only loaded once, however many models and instances use it
+	const TriangleMesh& getMesh(
+		const std::string& obj_filename,
+		std::map<std::string, TriangleMesh>* const& meshes
+	) {
+		std::map<std::string, TriangleMesh>::iterator mesh = meshes->find(obj_filename);
+		if (mesh == meshes->end()) {
+			mesh = meshes->emplace(obj_filename, ObjModel::loadMesh(obj_filename)).first;
 		}
+		return mesh->second;
+	}
+
+	// reads a line for each of fields (which can come in any order) into the
+	// attributes they name. Only the first required_field_count fields have to be
+	// given: the rest are optional, and keep whatever value they had if left out.
+	// Reading stops once every required field has been read and the next line
+	// isn't a field (has no ':').
+	template <size_t field_count>
+	void readSceneAttributes(
+		const SceneField (&fields)[field_count],
+		SceneReader* const& scenefile,
+		SceneAttributes* const& scene_attributes,
+		const size_t& required_field_count = field_count
+	) {
+		static_assert(field_count < 32, "Fields collected are tracked in 32 bits.");
+		const std::string& filename = scenefile->getFilename();
+		const uint32_t required_fields = (1u << required_field_count) - 1;
+
+		// bit i is set once fields[i] is read from file
+		uint32_t fields_collected = 0;
 
-		for (size_t i = 0, len = fieldnames.size(); i < len; i++) {
-			temp = getTrimmedLineFromFile(scenefile, line_number);
-			unsigned long colon_pos = temp.find(':');
-			std::string prefix = temp.substr(0, temp.find(':'));
-			if (std::find(fieldnames.begin(), fieldnames.end(), prefix) == fieldnames.end()) {
-				throw unknownFieldError(prefix, filename, *line_number);
+		while (
+			(fields_collected & required_fields) != required_fields ||
+			scenefile->peekLine().find(':') != boost::string_ref::npos
+		) {
+			boost::string_ref line = scenefile->readLine();
+			int line_number = scenefile->getLineNumber();
+			size_t colon_pos = line.find(':');
+			boost::string_ref prefix = line.substr(0, colon_pos);
+			boost::string_ref value = colon_pos == boost::string_ref::npos ?
+				boost::string_ref() :
+				line.substr(colon_pos + 1);
+
+			size_t field = 0;
+			while (
+				field < field_count &&
+				prefix != boost::string_ref(fields[field].name)
+			) {
+				field++;
+			}
+			if (field == field_count) {
+				throw unknownFieldError(prefix.to_string(), filename, line_number);
 			}
-			if (fields_collected[prefix]) {
-				throw duplicateFieldError(prefix, filename, *line_number);
+			if (fields_collected & (1u << field)) {
+				throw duplicateFieldError(prefix.to_string(), filename, line_number);
 			}
-			if (isFloatAttribute(prefix)) {
-				(*scene_attributes)[prefix] = std::stof(getTrimmedSubstring(temp, colon_pos + 1));
+
+			// anything after the number(s) is ignored
+			const char* cursor = value.data();
+			const char* value_end = value.data() + value.size();
+			bool is_well_formed;
+			if (fields[field].number) {
+				float* number = &(scene_attributes->*fields[field].number);
+				is_well_formed = parseFloat(&cursor, value_end, number);
 			} else {
-				float x, y, z;
-				int matches = sscanf(
-					getTrimmedSubstring(temp, colon_pos + 1).c_str(),
-					"%f %f %f",
-					&x, &y, &z
-				);
-				if (matches != 3) {
-					throw deformedFieldError(prefix, filename, *line_number);
-				}
-				(*scene_attributes)[prefix] = glm::vec3(x, y, z);
+				glm::vec3* vector = &(scene_attributes->*fields[field].vector);
+				is_well_formed =
+					parseFloat(&cursor, value_end, &vector->x) &&
+					parseFloat(&cursor, value_end, &vector->y) &&
+					parseFloat(&cursor, value_end, &vector->z);
 			}
-			fields_collected[prefix] = true;
+			if (!is_well_formed) {
+				throw deformedFieldError(prefix.to_string(), filename, line_number);
+			}
+			fields_collected |= 1u << field;
 		}
-		for (const std::string& fieldname : fieldnames) {
-			if (!fields_collected[fieldname]) {
-				throw missingFieldError(fieldname, filename, *line_number);
+		for (size_t i = 0; i < required_field_count; i++) {
+			if (!(fields_collected & (1u << i))) {
+				throw missingFieldError(
+					fields[i].name,
+					filename,
+					scenefile->getLineNumber()
+				);
 			}
 		}
 	}
@@ -175,155 +386,183 @@ void loadScene(
 	std::vector<Light>* const& lights,
 	std::vector<Object3D*>* const& scene_objects
 ) {
+	PROFILE_SCOPE(load_scene);
 	try {
-		int line_number = 0;
+		scl::SceneReader scenefile(filename);
 
-		std::ifstream scenefile(filename);
+		boost::string_ref first_line = scenefile.readLine();
+		int entity_count = std::stoi(first_line.to_string());
 
-		std::string first_line = scl::getTrimmedLineFromFile(&scenefile, &line_number);
-		int entity_count = std::stoi(first_line);
+		// meshes loaded so far, by .obj filename
+		std::map<std::string, TriangleMesh> meshes;
 
 		// read in the number of entities specified at the top of the file
 		bool camera_read = false;
 		for (int i = entity_count; i--; ) {
-			std::string entity_type = scl::getTrimmedLineFromFile(&scenefile, &line_number);
+			boost::string_ref entity_type = scenefile.readLine();
 
-			// for holding onto data while it's being parsed
-			std::string temp;
+			scl::SceneAttributes scene_attributes;
 
 			// different behavior depending on entity type
 			if (entity_type == "camera") {
-				static std::vector<std::string> fieldnames = {
-					scl::pos, scl::fov, scl::f, scl::a
+				// dir and up are optional
+				static const scl::SceneField fields[] = {
+					scl::pos, scl::fov, scl::f, scl::a, scl::dir, scl::up
 				};
+				scene_attributes.dir = glm::vec3(0.0f, 0.0f, -1.0f);
+				scene_attributes.up = glm::vec3(0.0f, 1.0f, 0.0f);
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 4);
+				// only the first camera is used
 				if (!camera_read) {
-					std::map<std::string, scl::scene_attribute> scene_attributes;
-					scl::readSceneAttributes(
-						fieldnames,
-						filename,
-						&scene_attributes,
-						&scenefile,
-						&line_number
-					);
-					*camera = Camera(
-						boost::get<glm::vec3>(scene_attributes[scl::pos]),
-						glm::radians(boost::get<float>(scene_attributes[scl::fov])),
-						boost::get<float>(scene_attributes[scl::f]),
-						boost::get<float>(scene_attributes[scl::a])
-					);
+					try {
+						*camera = Camera(
+							scene_attributes.pos,
+							glm::radians(scene_attributes.fov),
+							scene_attributes.f,
+							scene_attributes.a,
+							scene_attributes.dir,
+							scene_attributes.up
+						);
+					} catch (const std::invalid_argument&) {
+						throw scl::deformedFieldError("dir", filename, scenefile.getLineNumber());
+					}
 					camera_read = true;
 				}
 			} else if (entity_type == "light") {
-				static std::vector<std::string> fieldnames = {scl::pos, scl::col};
-				std::map<std::string, scl::scene_attribute> scene_attributes;
-				scl::readSceneAttributes(
-					fieldnames,
-					filename,
-					&scene_attributes,
-					&scenefile,
-					&line_number
+				static const scl::SceneField fields[] = {scl::pos, scl::col};
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes);
+				lights->emplace_back(scene_attributes.pos, scene_attributes.col);
+			} else if (entity_type == "rectlight") {
+				static const scl::SceneField fields[] = {
+					scl::pos, scl::e1, scl::e2, scl::col, scl::samples
+				};
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 4);
+				lights->push_back(
+					Light::makeRectangle(
+						scene_attributes.pos,
+						scene_attributes.e1,
+						scene_attributes.e2,
+						scene_attributes.col,
+						scl::getSampleCount(scene_attributes, scenefile)
+					)
 				);
-				lights->emplace_back(
-					boost::get<glm::vec3>(scene_attributes[scl::pos]),
-					boost::get<glm::vec3>(scene_attributes[scl::col])
+			} else if (entity_type == "spherelight") {
+				static const scl::SceneField fields[] = {
+					scl::pos, scl::rad, scl::col, scl::samples
+				};
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 3);
+				if (!(scene_attributes.rad >= 0.0f)) {
+					throw scl::deformedFieldError("rad", filename, scenefile.getLineNumber());
+				}
+				lights->push_back(
+					Light::makeSphere(
+						scene_attributes.pos,
+						scene_attributes.rad,
+						scene_attributes.col,
+						scl::getSampleCount(scene_attributes, scenefile)
+					)
 				);
 			} else if (entity_type == "sphere") {
-				static std::vector<std::string> fieldnames = {
-					scl::pos, scl::rad, scl::amb, scl::dif, scl::spe, scl::shi
+				static const scl::SceneField fields[] = {
+					scl::pos, scl::rad, scl::amb, scl::dif, scl::spe, scl::shi,
+					scl::ref, scl::tra, scl::ior
 				};
-				std::map<std::string, scl::scene_attribute> scene_attributes;
-				scl::readSceneAttributes(
-					fieldnames,
-					filename,
-					&scene_attributes,
-					&scenefile,
-					&line_number
-				);
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 6);
 				scene_objects->push_back(
 					new Sphere(
-						boost::get<glm::vec3>(scene_attributes[scl::pos]),
-						boost::get<float>(scene_attributes[scl::rad]),
-						boost::get<glm::vec3>(scene_attributes[scl::amb]),
-						boost::get<glm::vec3>(scene_attributes[scl::dif]),
-						boost::get<glm::vec3>(scene_attributes[scl::spe]),
-						boost::get<float>(scene_attributes[scl::shi])
+						scene_attributes.pos,
+						scene_attributes.rad,
+						scene_attributes.amb,
+						scene_attributes.dif,
+						scene_attributes.spe,
+						scene_attributes.shi
 					)
 				);
+				scl::setOptics(scene_attributes, scene_objects->back(), scenefile);
 			} else if (entity_type == "plane") {
-				static std::vector<std::string> fieldnames = {
-					scl::nor, scl::pos, scl::amb, scl::dif, scl::spe, scl::shi
+				static const scl::SceneField fields[] = {
+					scl::nor, scl::pos, scl::amb, scl::dif, scl::spe, scl::shi,
+					scl::ref, scl::tra, scl::ior
 				};
-				std::map<std::string, scl::scene_attribute> scene_attributes;
-				scl::readSceneAttributes(
-					fieldnames,
-					filename,
-					&scene_attributes,
-					&scenefile,
-					&line_number
-				);
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 6);
 				scene_objects->push_back(
 					new Plane(
-						boost::get<glm::vec3>(scene_attributes[scl::nor]),
-						boost::get<glm::vec3>(scene_attributes[scl::pos]),
-						boost::get<glm::vec3>(scene_attributes[scl::amb]),
-						boost::get<glm::vec3>(scene_attributes[scl::dif]),
-						boost::get<glm::vec3>(scene_attributes[scl::spe]),
-						boost::get<float>(scene_attributes[scl::shi])
+						scene_attributes.nor,
+						scene_attributes.pos,
+						scene_attributes.amb,
+						scene_attributes.dif,
+						scene_attributes.spe,
+						scene_attributes.shi
 					)
 				);
+				scl::setOptics(scene_attributes, scene_objects->back(), scenefile);
 			} else if (entity_type == "triangle") {
-				static std::vector<std::string> fieldnames = {
-					scl::v1, scl::v2, scl::v3, scl::amb, scl::dif, scl::spe, scl::shi
+				static const scl::SceneField fields[] = {
+					scl::v1, scl::v2, scl::v3, scl::amb, scl::dif, scl::spe, scl::shi,
+					scl::ref, scl::tra, scl::ior
 				};
-				std::map<std::string, scl::scene_attribute> scene_attributes;
-				scl::readSceneAttributes(
-					fieldnames,
-					filename,
-					&scene_attributes,
-					&scenefile,
-					&line_number
-				);
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 7);
 				scene_objects->push_back(
 					new Triangle(
-						boost::get<glm::vec3>(scene_attributes[scl::v1]),
-						boost::get<glm::vec3>(scene_attributes[scl::v2]),
-						boost::get<glm::vec3>(scene_attributes[scl::v3]),
-						boost::get<glm::vec3>(scene_attributes[scl::amb]),
-						boost::get<glm::vec3>(scene_attributes[scl::dif]),
-						boost::get<glm::vec3>(scene_attributes[scl::spe]),
-						boost::get<float>(scene_attributes[scl::shi])
+						scene_attributes.v1,
+						scene_attributes.v2,
+						scene_attributes.v3,
+						scene_attributes.amb,
+						scene_attributes.dif,
+						scene_attributes.spe,
+						scene_attributes.shi
 					)
 				);
+				scl::setOptics(scene_attributes, scene_objects->back(), scenefile);
 			} else if (entity_type == "model") {
 				// this is always on the line after 'model'
-				std::string obj_filename = scl::getTrimmedLineFromFile(&scenefile, &line_number);
-				// get rid of quotation marks
-				if (obj_filename[0] == '"' && obj_filename[obj_filename.length() - 1] == '"') {
-					obj_filename = obj_filename.substr(1, obj_filename.length() - 2);
-				}
+				std::string obj_filename = scl::readModelFilename(&scenefile, filename);
 
-				static std::vector<std::string> fieldnames = {
-					scl::amb, scl::dif, scl::spe, scl::shi
+				static const scl::SceneField fields[] = {
+					scl::amb, scl::dif, scl::spe, scl::shi, scl::ref, scl::tra, scl::ior
 				};
-				std::map<std::string, scl::scene_attribute> scene_attributes;
-				scl::readSceneAttributes(
-					fieldnames,
-					filename,
-					&scene_attributes,
-					&scenefile,
-					&line_number
-				);
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 4);
 				scene_objects->push_back(
 					new ObjModel(
-						(models_dir / fs::path(obj_filename)).string(),
-						boost::get<glm::vec3>(scene_attributes[scl::amb]),
-						boost::get<glm::vec3>(scene_attributes[scl::dif]),
-						boost::get<glm::vec3>(scene_attributes[scl::spe]),
-						boost::get<float>(scene_attributes[scl::shi])
+						scl::getMesh(obj_filename, &meshes),
+						scene_attributes.amb,
+						scene_attributes.dif,
+						scene_attributes.spe,
+						scene_attributes.shi
 					)
 				);
+				scl::setOptics(scene_attributes, scene_objects->back(), scenefile);
+			} else if (entity_type == "instance") {
+				// this is always on the line after 'instance'
+				std::string obj_filename = scl::readModelFilename(&scenefile, filename);
+
+				static const scl::SceneField fields[] = {
+					scl::pos, scl::rot, scl::sca, scl::amb, scl::dif, scl::spe, scl::shi,
+					scl::ref, scl::tra, scl::ior
+				};
+				scl::readSceneAttributes(fields, &scenefile, &scene_attributes, 7);
+				const TriangleMesh& mesh = scl::getMesh(obj_filename, &meshes);
+				try {
+					scene_objects->push_back(
+						new MeshInstance(
+							mesh,
+							scene_attributes.pos,
+							scene_attributes.rot,
+							scene_attributes.sca,
+							scene_attributes.amb,
+							scene_attributes.dif,
+							scene_attributes.spe,
+							scene_attributes.shi
+						)
+					);
+				} catch (const std::invalid_argument&) {
+					throw scl::deformedFieldError("sca", filename, scenefile.getLineNumber());
+				}
+				scl::setOptics(scene_attributes, scene_objects->back(), scenefile);
 			} else {
-				throw std::runtime_error("Unknown entity type '" + entity_type + "'.");
+				throw std::runtime_error(
+					"Unknown entity type '" + entity_type.to_string() + "'."
+				);
 			}
 		}
 	} catch(error_t e) {
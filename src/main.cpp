@@ -8,10 +8,11 @@
 #include <string>
 #include <sstream>
 #include <thread>
-#include <mutex>
+#include <atomic>
 #include <chrono>
 #include <vector>
-#include <utility>
+#include <memory>
+#include <cstdint>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "vendor/stb_image_write.h"
@@ -19,8 +20,21 @@
 #include "entities/Camera.hpp"
 #include "entities/Light.hpp"
 #include "entities/objects/Object3D.hpp"
-#include "loadScene.hpp"
+#include "accel/BVH.hpp"
+#include "accel/SceneBVH.hpp"
+#include "accel/packetKernels.hpp"
+#include "render/TileScheduler.hpp"
+#include "render/StreamedImage.hpp"
+#include "render/Checkpoint.hpp"
+#include "render/AdaptiveSampling.hpp"
+#include "render/CostMap.hpp"
+#include "render/Renderer.hpp"
+#include "render/PreviewWindow.hpp"
+#include "profiling/Profiler.hpp"
 #include "getColorForRay.hpp"
+#include "loadScene.hpp"
+#include "parseCommandLine.hpp"
+#include "hashFile.hpp"
 #include "constants.hpp"
 
 namespace fs = boost::filesystem;
@@ -28,7 +42,8 @@ namespace fs = boost::filesystem;
 // run in main thread
 std::string getSceneFilename();
 
-// run in separate ray tracing thread
+// run in separate thread, while Renderer workers do the ray tracing (and a
+// PreviewWindow, if shown, displays it from a thread of its own)
 void raytraceScene();
 
 // run in main thread
@@ -37,58 +52,246 @@ void waitForInput();
 // run in main thread
 void saveImage();
 
+// run in main thread
+bool writeImage(const std::string& filename);
+
+// writes an RGB image the size of the render, in the format given by filename's
+// extension
+bool writePixels(const std::string& filename, const unsigned char* const& data);
+
+// run in main thread, once the render is done
+bool saveHeatmap();
+
+// run in whichever thread is displaying progress, or main thread once render stops
+void saveCheckpoint();
+
 std::thread t;
-std::mutex mut;
+
+CommandLineOptions options;
 
 Camera camera;
 std::vector<Light> lights;
 std::vector<Object3D*> scene_objects;
+SceneBVH scene_bvh;
 
-const int image_channels = 3;
+std::unique_ptr<Renderer> renderer;
+// only set when streaming the render to disk
+std::unique_ptr<StreamedImage> streamed_image;
+// only set when saving a heatmap
+std::unique_ptr<CostMap> cost_map;
 
-std::vector<char> image;
-unsigned int image_width;
-unsigned int image_height;
+// of the scene file, so checkpoints are only resumed into the scene they're from
+uint64_t scene_hash;
+std::string checkpoint_filename;
 
-bool done = false;
-bool force_quit = false;
+std::atomic<bool> done(false);
+std::atomic<bool> force_quit(false);
+// true while waiting on a choice from the user
+std::atomic<bool> prompting(false);
 
-int main()
+int main(int argc, char** argv)
 {
-	loadScene(getSceneFilename(), &camera, &lights, &scene_objects);
+	try {
+		options = parseCommandLine(argc, argv);
+	} catch (const std::runtime_error& e) {
+		std::cerr << e.what() << std::endl << std::endl;
+		std::cerr << getCommandLineUsage(argv[0]);
+		return 2;
+	}
+	if (options.show_help) {
+		std::cout << getCommandLineUsage(argv[0]);
+		return 0;
+	}
+
+	// stays nullptr if rays should be traced one at a time
+	const PacketKernels* packet_kernels = nullptr;
+	if (options.simd == "auto") {
+		packet_kernels = &getPacketKernels();
+	} else if (options.simd != "off") {
+		packet_kernels = getPacketKernels(options.simd);
+		if (!packet_kernels) {
+			std::cerr << "Instruction set '" << options.simd
+				<< "' isn't supported on this machine." << std::endl;
+			return 2;
+		}
+	}
+
+	if (options.stream) {
+		// the preview is drawn from the in-memory image, which isn't kept when
+		// streaming
+		options.show_window = false;
+	}
+
+	bool is_interactive = options.output_filename.empty();
+	bool prompted_for_scene = options.scene_filename.empty();
+
+	std::string scene_filename =
+		prompted_for_scene ? getSceneFilename() : options.scene_filename;
+	try {
+		loadScene(scene_filename, &camera, &lights, &scene_objects);
+		scene_hash = hashFile(scene_filename);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	scene_bvh = SceneBVH(scene_objects);
+	const BVHBuildStats& stats = scene_bvh.getBVH().getBuildStats();
+	std::cout << "Built scene BVH in " << stats.build_milliseconds << " ms: "
+		<< stats.primitive_count << " bounded objects, " << stats.node_count
+		<< " nodes, depth " << stats.max_depth << " ("
+		<< scene_bvh.getUnboundedObjectCount() << " unbounded objects tested separately)."
+		<< std::endl;
+
+	renderer.reset(new Renderer(camera, lights, scene_bvh, options.thread_count));
+	renderer->setPacketKernels(packet_kernels);
+	if (options.antialias) {
+		AdaptiveSampling sampling;
+		sampling.min_samples = options.aa_min_samples;
+		sampling.max_samples = options.aa_max_samples;
+		sampling.threshold = options.aa_threshold;
+		renderer->setAdaptiveSampling(sampling);
+	}
+	if (options.integrator == "path") {
+		renderer->setIntegrator(Integrator::path);
+		if (!options.antialias && options.progressive_samples == 0) {
+			// a fixed number of samples per pixel, spread over it as for anti-aliasing
+			AdaptiveSampling sampling;
+			sampling.min_samples = options.path_samples ?
+				options.path_samples :
+				default_path_samples;
+			sampling.max_samples = sampling.min_samples;
+			renderer->setAdaptiveSampling(sampling);
+		}
+	}
+	if (options.progressive_samples > 0) {
+		renderer->setProgressiveSampleCount(options.progressive_samples);
+	}
+	if (!options.heatmap_filename.empty()) {
+		cost_map.reset(new CostMap(renderer->getImageWidth(), renderer->getImageHeight()));
+		renderer->setCostMap(cost_map.get());
+	}
+
+	checkpoint_filename = is_interactive ?
+		(renders_dir / fs::path(scene_filename).stem()).string() + ".checkpoint" :
+		options.output_filename + ".checkpoint";
+
+	if (options.stream) {
+		try {
+			streamed_image.reset(new StreamedImage(
+				options.output_filename,
+				renderer->getImageWidth(),
+				renderer->getImageHeight(),
+				renderer->getTileSize(),
+				scene_hash,
+				renderer->getRenderSettings(),
+				options.resume
+			));
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		renderer->setStreamedImage(streamed_image.get());
+	} else if (options.resume && fs::exists(checkpoint_filename)) {
+		try {
+			Checkpoint checkpoint = Checkpoint::load(checkpoint_filename);
+			if (checkpoint.scene_hash != scene_hash) {
+				throw std::runtime_error(
+					"Checkpoint " + checkpoint_filename + " is of a different scene."
+				);
+			}
+			renderer->restoreCheckpoint(checkpoint);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+	if (renderer->getCompletedTileCount() > 0) {
+		std::cout << "Resuming render: " << renderer->getCompletedTileCount() << " of "
+			<< renderer->getTileCount() << " tiles already done." << std::endl;
+	}
 
 	// Print blank line before beginning ray tracing
 	std::cout << std::endl;
 
-	t = std::thread(raytraceScene);
+	int status = 0;
+	if (is_interactive) {
+		t = std::thread(raytraceScene);
 
-	std::cin.clear(); // clear inputs that could be read immediately
-	std::cin.ignore();
+		if (prompted_for_scene) {
+			std::cin.clear(); // clear inputs that could be read immediately
+			std::cin.ignore();
+		}
 
-	std::string trash; // input that won't get used
-	while (!done) {
-		std::getline(std::cin, trash); // wait for user to hit enter
-		if (!done) {
-			waitForInput();
-		} // else: ray tracing thread finished while we were waiting!
-	}
+		std::string trash; // input that won't get used
+		while (!done) {
+			std::getline(std::cin, trash); // wait for user to hit enter
+			if (!done) {
+				waitForInput();
+			} // else: ray tracing thread finished while we were waiting!
+		}
 
-	if (!force_quit) {
-		// prompt user to save final image
-		saveImage();
+		if (!force_quit) {
+			// prompt user to save final image
+			saveImage();
+			fs::remove(checkpoint_filename);
+			if (cost_map && !saveHeatmap()) {
+				status = 1;
+			}
+		} else if (!streamed_image) {
+			saveCheckpoint();
+			std::cout << "Progress saved to " << checkpoint_filename
+				<< ". Run again with --resume to carry on." << std::endl;
+		}
+
+		if (t.joinable()) {
+			// wait for raytraceScene thread to finish if it's still not closed
+			t.join();
+		}
+	} else {
+		// nothing to wait on, so just ray trace from the main thread
+		raytraceScene();
+		bool saved = streamed_image ?
+			streamed_image->finish() :
+			writeImage(options.output_filename);
+		if (!saved) {
+			std::cerr << "Failed to write image to " << options.output_filename << "."
+				<< std::endl;
+			status = 1;
+		} else {
+			std::cout << "Image saved to " << options.output_filename << "." << std::endl;
+			fs::remove(checkpoint_filename);
+		}
+		if (cost_map && !saveHeatmap()) {
+			status = 1;
+		}
 	}
 
+	// stop worker threads before the scene goes away
+	renderer.reset();
+
 	// deallocate our objects
 	for (Object3D* object : scene_objects) {
 		delete object;
 	}
 
-	if (t.joinable()) {
-		// wait for raytraceScene thread to finish if it's still not closed
-		t.join();
+	if (Profiler::is_enabled) {
+		// every thread but this one is done by now
+		std::cout << std::endl;
+		Profiler::writeSummary(std::cout);
+	}
+	if (!options.profile_filename.empty()) {
+		if (Profiler::writeTrace(options.profile_filename)) {
+			std::cout << "Profile trace saved to " << options.profile_filename << "."
+				<< std::endl;
+		} else {
+			std::cerr << "Failed to write profile trace to " << options.profile_filename
+				<< "." << std::endl;
+			status = 1;
+		}
 	}
 
-	return 0;
+	return status;
 }
 
 std::string getSceneFilename()
@@ -129,140 +332,168 @@ std::string getSceneFilename()
 	return filenames[option];
 }
 
-size_t printProgress(const size_t& iterations, const size_t& total)
+void printProgress(const size_t& iterations, const size_t& total)
 {
 	static size_t last_progress = 0;
 	size_t progress = iterations * 100 / total;
-	if (progress > last_progress) {
+	if (progress > last_progress && !prompting) {
 		std::cout << progress << "%" << std::endl;
 		last_progress = progress;
-	} else if (iterations % 1000 == 0) {
-		std::cout << ". ";
 	}
 }
 
-void quitSDL(SDL_Window* window, SDL_Renderer* renderer, SDL_Texture* texture)
+void printRayCounts()
 {
-	SDL_DestroyTexture(texture);
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
-	SDL_Quit();
+	RayCounts counts = renderer->getRayCounts();
+	std::cout << "Rays traced: " << counts.primary_rays << " primary, "
+		<< counts.secondary_rays << " secondary, "
+		<< counts.shadow_rays << " shadow." << std::endl;
 }
 
-void raytraceScene()
+void printTraversalStats()
 {
-	std::chrono::seconds trace_duration(1);
-	std::chrono::microseconds wait_duration(100);
+	BVHTraversalStats stats = renderer->getTraversalStats();
+	if (stats.rays == 0) {
+		return;
+	}
+	// scene and model BVHs share counters, so a single ray can count as several
+	// traversals (one through the scene BVH, plus one per model it reaches)
+	std::cout << "BVH traversal: " << stats.rays << " traversals, "
+		<< (double)stats.nodes_visited / stats.rays << " nodes visited and "
+		<< (double)stats.primitive_tests / stats.rays << " primitive tests per traversal."
+		<< std::endl;
+}
 
-	mut.lock();
+void printPreviewStats(const PreviewStats& stats)
+{
+	if (stats.frames == 0) {
+		return;
+	}
+	std::cout << "Preview: " << stats.frames << " frames at up to " << stats.refresh_rate
+		<< " Hz (" << 1000.0 / stats.refresh_rate << " ms budget), "
+		<< stats.total_frame_milliseconds / stats.frames << " ms average and "
+		<< stats.max_frame_milliseconds << " ms worst per frame, "
+		<< stats.dropped_frames << " frames dropped." << std::endl;
+}
 
-	glm::vec3 center_of_projection = camera.getPosition();
-	const std::vector<std::pair<glm::vec3, int>>& rays = camera.getRays(
-		&image_width,
-		&image_height
-	);
-	image.assign(rays.size() * image_channels, 0);
-
-	// SDL setup inspired by:
-	// https://stackoverflow.com/a/35989490/4956731
-	SDL_Init(SDL_INIT_VIDEO);
-	SDL_Window *window;
-	SDL_Renderer *renderer;
-	SDL_CreateWindowAndRenderer(image_width, image_height, 0, &window, &renderer);
-
-	// Help using texture for display from:
-	// https://stackoverflow.com/a/20091474/4956731
-	SDL_Texture* display = SDL_CreateTexture(
-		renderer,
-		SDL_PIXELFORMAT_RGB888,
-		SDL_TEXTUREACCESS_TARGET,
-		image_width,
-		image_height
-	);
+void raytraceScene()
+{
+	// how often to check on progress
+	std::chrono::milliseconds refresh_duration(15);
+	std::chrono::seconds checkpoint_duration(options.checkpoint_interval_seconds);
+	// streamed images are already saved as each tile finishes
+	bool is_checkpointing = !streamed_image;
+
+	bool is_interactive = options.output_filename.empty();
+	const PacketKernels* packet_kernels = renderer->getPacketKernels();
+	std::cout << "Ray tracing scene on " << renderer->getThreadCount() << " threads, "
+		<< (packet_kernels ? std::string(packet_kernels->name) + " packets" : "single rays")
+		<< "...";
+	if (renderer->getIntegrator() == Integrator::path) {
+		std::cout << " (path tracing)";
+	}
+	if (renderer->getAdaptiveSampling()) {
+		const AdaptiveSampling& sampling = *renderer->getAdaptiveSampling();
+		std::cout << " (anti-aliasing with " << sampling.min_samples << " to "
+			<< sampling.max_samples << " samples per pixel)";
+	}
+	if (renderer->getProgressiveSampleCount()) {
+		std::cout << " (progressively, " << renderer->getProgressiveSampleCount()
+			<< " samples per pixel)";
+	}
+	if (is_interactive) {
+		std::cout << " (enter any input for options)";
+	}
+	std::cout << std::endl;
+	renderer->start();
+	// without a window we never touch SDL, so no display is needed
+	std::unique_ptr<PreviewWindow> preview;
+	if (options.show_window) {
+		preview.reset(new PreviewWindow(*renderer));
+	}
+	std::chrono::steady_clock::time_point last_checkpoint_time =
+		std::chrono::steady_clock::now();
+	size_t last_checkpoint_tile_count = renderer->getCompletedTileCount();
+	bool is_preview_closed = false;
+	bool finished = false;
+	while (!finished) {
+		finished = renderer->isDone();
 
-	// render to texture
-	SDL_SetRenderTarget(renderer, display);
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-	SDL_RenderClear(renderer);
-	SDL_SetRenderTarget(renderer, nullptr);
-
-	SDL_Event event;
-	bool window_closed = false;
-
-	std::cout << "Ray tracing scene... (enter any input to pause)" << std::endl;
-	for (size_t i = 0; !done && i < rays.size(); i++) {
-		glm::vec3 direction = rays[i].first;
-		glm::vec3 color = getColorForRay(
-			center_of_projection,
-			direction,
-			lights,
-			scene_objects
-		);
-		auto color_r = (uint8_t)round(255.0 * color.r);
-		auto color_g = (uint8_t)round(255.0 * color.g);
-		auto color_b = (uint8_t)round(255.0 * color.b);
-
-		int index = rays[i].second;
-		image[index * image_channels] = (unsigned char)color_r;
-		image[index * image_channels + 1] = (unsigned char)color_g;
-		image[index * image_channels + 2] = (unsigned char)color_b;
-
-		// close window if requested
-		if (SDL_PollEvent(&event) && event.type == SDL_QUIT) {
-			quitSDL(window, renderer, display);
-			window_closed = true;
+		// indicate progress
+		printProgress(renderer->getCompletedTileCount(), renderer->getTileCount());
+
+		// closing the window only stops the preview
+		if (preview && !is_preview_closed && preview->isClosed()) {
+			is_preview_closed = true;
+			if (!prompting) {
+				std::cout << "Preview window closed. Rendering carries on." << std::endl;
+			}
 		}
-		// update image with new pixel value
-		if (!window_closed) {
-			// render to texture
-			SDL_SetRenderTarget(renderer, display);
-
-			SDL_SetRenderDrawColor(renderer, color_r, color_g, color_b, 255);
-			SDL_RenderDrawPoint(renderer, index % image_width, index / image_width);
-
-			// unset texture target
-			SDL_SetRenderTarget(renderer, nullptr);
-
-			// copy texture to renderer
-			SDL_RenderCopy(renderer, display, nullptr, nullptr);
 
-			// render on screen
-			SDL_RenderPresent(renderer);
+		// save progress in case the render is interrupted
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (
+			is_checkpointing &&
+			!finished &&
+			now - last_checkpoint_time >= checkpoint_duration &&
+			renderer->getCompletedTileCount() != last_checkpoint_tile_count
+		) {
+			last_checkpoint_tile_count = renderer->getCompletedTileCount();
+			saveCheckpoint();
+			last_checkpoint_time = now;
 		}
 
-		// indicate progress
-		printProgress(i, rays.size());
-
-		mut.unlock(); // possibly defer to waitForInput
-		// sleep for extremely small duration to give main thread time to register inputs
-		std::this_thread::sleep_for(wait_duration);
-		mut.lock(); // pick up when waitForInput has given back control
+		if (!finished) {
+			std::this_thread::sleep_for(refresh_duration);
+		}
+	}
+	renderer->wait();
+	if (preview) {
+		// shows the last few tiles before closing
+		preview->close();
 	}
 
 	done = true;
 	// Main thread will take care of save after enter
 	std::cout << "Ray tracing complete." << std::endl;
-	if (!force_quit) {
+	printRayCounts();
+	printTraversalStats();
+	std::vector<double> pass_milliseconds = renderer->getPassMilliseconds();
+	// (unless the render was stopped part way through)
+	if (
+		renderer->getProgressiveSampleCount() &&
+		pass_milliseconds.size() == renderer->getPassCount()
+	) {
+		std::cout << "Progressive passes: preview done after " << pass_milliseconds[0]
+			<< " ms, first sample of every pixel after " << pass_milliseconds[1]
+			<< " ms, all " << renderer->getProgressiveSampleCount() << " after "
+			<< pass_milliseconds.back() << " ms." << std::endl;
+	}
+	if (renderer->getAdaptiveSampling()) {
+		std::cout << "Anti-aliasing: " << renderer->getAverageSampleCount()
+			<< " samples per pixel on average." << std::endl;
+	}
+	if (preview) {
+		printPreviewStats(preview->getStats());
+	}
+	if (is_interactive && !force_quit) {
 		std::cout << " Press enter to save final image.";
 	}
 	std::cout << std::endl;
-
-	if (!window_closed) {
-		quitSDL(window, renderer, display);
-	}
 }
 
 void waitForInput()
 {
-	std::cout << "Pausing ray trace..." << std::endl;
-	mut.lock();
-	std::cout << "Enter 's' to save an image snapshot, 'q' to quit, ";
+	// the render carries on while waiting for a choice, so snapshots don't hold
+	// it up, but progress isn't printed over the prompt
+	prompting = true;
+	std::cout << "Enter 's' to save an image snapshot, 'p' to pause, 'q' to quit, ";
 	std::cout << "or anything else to continue." << std::endl;
 	auto c = (char)getchar();
 	if (c == 'q' || c == 'Q') {
 		done = true;
 		force_quit = true;
-		mut.unlock();
+		renderer->stop();
 		if (t.joinable()) {
 			// wait for raytraceScene thread to finish
 			t.join();
@@ -270,11 +501,19 @@ void waitForInput()
 		return;
 	}
 	if (c == 's' || c == 'S') {
-		// save partial image to file
+		// save tiles finished so far to file
 		saveImage();
+	} else if (c == 'p' || c == 'P') {
+		std::cout << "Pausing ray trace..." << std::endl;
+		renderer->pause();
+		std::cout << "Paused. Press enter to resume." << std::endl;
+		std::string trash; // input that won't get used
+		std::cin.ignore(); // rest of the line 'p' was entered on
+		std::getline(std::cin, trash);
+		renderer->resume();
 	}
-	std::cout << "Resuming ray trace... (enter any input to pause)" << std::endl;
-	mut.unlock(); // return control to raytraceScene
+	std::cout << "Continuing ray trace... (enter any input for options)" << std::endl;
+	prompting = false;
 }
 
 void saveImage()
@@ -289,13 +528,76 @@ void saveImage()
 		filename += ".bmp";
 	}
 
-	stbi_write_bmp(
-		(renders_dir / fs::path(filename)).c_str(),
-		image_width,
-		image_height,
-		image_channels,
-		image.data()
-	);
+	writeImage((renders_dir / fs::path(filename)).string());
 
 	std::cout << "Image saved to " << filename << "." << std::endl;
 }
+
+bool writeImage(const std::string& filename)
+{
+	PROFILE_SCOPE(write_image);
+	// consistent copy of every finished tile, even while rendering
+	std::vector<unsigned char> image = renderer->getFramebuffer().copyImage();
+	return writePixels(filename, image.data());
+}
+
+bool writePixels(const std::string& filename, const unsigned char* const& data)
+{
+	const char* path = filename.c_str();
+	int width = renderer->getImageWidth();
+	int height = renderer->getImageHeight();
+	const int channels = Renderer::image_channels;
+
+	std::string extension = boost::algorithm::to_lower_copy(
+		fs::path(filename).extension().string()
+	);
+	int result;
+	if (extension == ".png") {
+		result = stbi_write_png(path, width, height, channels, data, width * channels);
+	} else if (extension == ".tga") {
+		result = stbi_write_tga(path, width, height, channels, data);
+	} else if (extension == ".jpg" || extension == ".jpeg") {
+		result = stbi_write_jpg(path, width, height, channels, data, 95);
+	} else {
+		result = stbi_write_bmp(path, width, height, channels, data);
+	}
+	return result != 0;
+}
+
+bool saveHeatmap()
+{
+	CostMeasure measure = CostMeasure::time;
+	if (options.heatmap_measure == "tests") {
+		measure = CostMeasure::intersection_tests;
+	} else if (options.heatmap_measure == "shadow") {
+		measure = CostMeasure::shadow_rays;
+	}
+	float high_cost = cost_map->getHighCost(measure);
+	std::string floats_filename =
+		fs::path(options.heatmap_filename).replace_extension(".pfm").string();
+	std::vector<unsigned char> heatmap = cost_map->getHeatmap(measure, high_cost);
+	if (!writePixels(options.heatmap_filename, heatmap.data())) {
+		std::cerr << "Failed to write heatmap to " << options.heatmap_filename << "."
+			<< std::endl;
+		return false;
+	}
+	if (!cost_map->writeFloats(floats_filename)) {
+		std::cerr << "Failed to write pixel costs to " << floats_filename << "."
+			<< std::endl;
+		return false;
+	}
+	std::cout << "Heatmap of " << CostMap::getMeasureName(measure)
+		<< " per pixel saved to " << options.heatmap_filename << " (white for " << high_cost
+		<< " or more), and every measure to " << floats_filename << "." << std::endl;
+	return true;
+}
+
+void saveCheckpoint()
+{
+	Checkpoint checkpoint = renderer->getCheckpoint();
+	checkpoint.scene_hash = scene_hash;
+	if (!checkpoint.save(checkpoint_filename)) {
+		std::cerr << "Failed to save checkpoint to " << checkpoint_filename << "."
+			<< std::endl;
+	}
+}
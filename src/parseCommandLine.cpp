@@ -0,0 +1,251 @@
+#include <boost/algorithm/string.hpp>
+#include <string>
+#include <stdexcept>
+
+#include "profiling/Profiler.hpp"
+#include "parseCommandLine.hpp"
+
+namespace cli {
+	std::string getOptionValue(int argc, char** argv, int* const& i)
+	{
+		std::string option = argv[*i];
+		if (*i + 1 >= argc) {
+			throw std::runtime_error("Option '" + option + "' requires a value.");
+		}
+		(*i)++;
+		return argv[*i];
+	}
+
+	size_t parseCount(const std::string& option, const std::string& value)
+	{
+		size_t parsed_length = 0;
+		long count = -1;
+		try {
+			count = std::stol(value, &parsed_length);
+		} catch (const std::logic_error&) {
+			// handled below
+		}
+		if (count < 1 || parsed_length != value.length()) {
+			throw std::runtime_error(
+				"Option '" + option + "' expects a positive integer, got '" + value + "'."
+			);
+		}
+		return (size_t)count;
+	}
+
+	float parsePositiveFloat(const std::string& option, const std::string& value)
+	{
+		size_t parsed_length = 0;
+		float number = -1.0f;
+		try {
+			number = std::stof(value, &parsed_length);
+		} catch (const std::logic_error&) {
+			// handled below
+		}
+		if (!(number > 0.0f) || parsed_length != value.length()) {
+			throw std::runtime_error(
+				"Option '" + option + "' expects a positive number, got '" + value + "'."
+			);
+		}
+		return number;
+	}
+}
+
+CommandLineOptions parseCommandLine(int argc, char** argv)
+{
+	CommandLineOptions options;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--scene") {
+			options.scene_filename = cli::getOptionValue(argc, argv, &i);
+		} else if (arg == "--out") {
+			options.output_filename = cli::getOptionValue(argc, argv, &i);
+		} else if (arg == "--threads") {
+			options.thread_count = cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--simd") {
+			options.simd = cli::getOptionValue(argc, argv, &i);
+			if (
+				options.simd != "auto" && options.simd != "avx2" && options.simd != "sse" &&
+				options.simd != "scalar" && options.simd != "off"
+			) {
+				throw std::runtime_error(
+					"Option '--simd' expects one of auto, avx2, sse, scalar or off, got '" +
+						options.simd + "'."
+				);
+			}
+		} else if (arg == "--aa") {
+			options.antialias = true;
+		} else if (arg == "--aa-min") {
+			options.antialias = true;
+			options.aa_min_samples =
+				cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--aa-max") {
+			options.antialias = true;
+			options.aa_max_samples =
+				cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--aa-threshold") {
+			options.antialias = true;
+			options.aa_threshold =
+				cli::parsePositiveFloat(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--integrator") {
+			options.integrator = cli::getOptionValue(argc, argv, &i);
+			if (options.integrator != "whitted" && options.integrator != "path") {
+				throw std::runtime_error(
+					"Option '--integrator' expects one of whitted or path, got '" +
+						options.integrator + "'."
+				);
+			}
+		} else if (arg == "--spp") {
+			options.path_samples =
+				cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--progressive") {
+			options.progressive_samples =
+				cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--stream") {
+			options.stream = true;
+		} else if (arg == "--resume") {
+			options.resume = true;
+		} else if (arg == "--checkpoint-interval") {
+			options.checkpoint_interval_seconds =
+				cli::parseCount(arg, cli::getOptionValue(argc, argv, &i));
+		} else if (arg == "--heatmap") {
+			options.heatmap_filename = cli::getOptionValue(argc, argv, &i);
+			if (boost::algorithm::iends_with(options.heatmap_filename, ".pfm")) {
+				throw std::runtime_error(
+					"Option '--heatmap' expects an image file (the .pfm is written "
+						"alongside it)."
+				);
+			}
+		} else if (arg == "--heatmap-of") {
+			options.heatmap_measure = cli::getOptionValue(argc, argv, &i);
+			if (
+				options.heatmap_measure != "time" && options.heatmap_measure != "tests" &&
+				options.heatmap_measure != "shadow"
+			) {
+				throw std::runtime_error(
+					"Option '--heatmap-of' expects one of time, tests or shadow, got '" +
+						options.heatmap_measure + "'."
+				);
+			}
+		} else if (arg == "--no-window") {
+			options.show_window = false;
+		} else if (arg == "--profile") {
+			options.profile_filename = cli::getOptionValue(argc, argv, &i);
+			if (!Profiler::is_enabled) {
+				throw std::runtime_error(
+					"Option '--profile' requires a build with RAYTRACER_PROFILING on."
+				);
+			}
+		} else if (arg == "--help" || arg == "-h") {
+			options.show_help = true;
+		} else {
+			throw std::runtime_error("Unknown option '" + arg + "'.");
+		}
+	}
+	if (!options.output_filename.empty() && options.scene_filename.empty()) {
+		throw std::runtime_error("Option '--out' requires '--scene' to be given too.");
+	}
+	if (options.aa_min_samples < 2) {
+		throw std::runtime_error("Option '--aa-min' must be at least 2.");
+	}
+	if (options.aa_max_samples < options.aa_min_samples) {
+		throw std::runtime_error("Option '--aa-max' can't be less than '--aa-min'.");
+	}
+	if (options.progressive_samples > 0 && options.antialias) {
+		throw std::runtime_error("Option '--progressive' can't be combined with '--aa'.");
+	}
+	if (options.progressive_samples > 0 && options.stream) {
+		throw std::runtime_error(
+			"Option '--progressive' can't be combined with '--stream'."
+		);
+	}
+	if (options.path_samples > 0) {
+		if (options.integrator != "path") {
+			throw std::runtime_error("Option '--spp' requires '--integrator path'.");
+		}
+		if (options.antialias || options.progressive_samples > 0) {
+			throw std::runtime_error(
+				"Option '--spp' can't be combined with '--aa' or '--progressive'."
+			);
+		}
+	}
+	if (!options.heatmap_filename.empty()) {
+		if (options.progressive_samples > 0 || options.stream || options.resume) {
+			throw std::runtime_error(
+				"Option '--heatmap' can't be combined with '--progressive', '--stream' "
+					"or '--resume'."
+			);
+		}
+	} else if (options.heatmap_measure != "time") {
+		throw std::runtime_error(
+			"Option '--heatmap-of' requires '--heatmap' to be given too."
+		);
+	}
+	if (
+		options.stream &&
+		!boost::algorithm::iends_with(options.output_filename, ".ppm")
+	) {
+		throw std::runtime_error("Option '--stream' requires '--out' with a .ppm file.");
+	}
+	return options;
+}
+
+std::string getCommandLineUsage(const std::string& program_name)
+{
+	return "Usage: " + program_name + " [options]\n"
+		"\n"
+		"With no options, prompts for a scene from the scenes directory, displays the\n"
+		"render as it progresses and prompts for a filename to save it under.\n"
+		"\n"
+		"Options:\n"
+		"  --scene <file>   Scene file to render (skips the scene prompt)\n"
+		"  --out <file>     Save render here when done, then exit without reading\n"
+		"                   any input. Format is picked from the extension\n"
+		"                   (.png, .bmp, .tga or .jpg). Requires --scene.\n"
+		"  --threads <n>    Number of render threads (default: one per hardware\n"
+		"                   thread)\n"
+		"  --simd <set>     Instruction set for tracing primary rays in packets:\n"
+		"                   auto (default: widest the CPU supports), avx2, sse,\n"
+		"                   scalar, or off to trace rays one at a time\n"
+		"  --aa             Anti-alias adaptively: sample each pixel --aa-min times,\n"
+		"                   then keep adding samples while their mean's standard\n"
+		"                   error is over --aa-threshold, up to --aa-max\n"
+		"  --aa-min <n>     Samples every pixel gets (default: 4, at least 2).\n"
+		"                   Implies --aa.\n"
+		"  --aa-max <n>     Most samples a pixel gets (default: 64). Implies --aa.\n"
+		"  --aa-threshold <error>\n"
+		"                   Standard error in any color channel (from 0 to 1) above\n"
+		"                   which a pixel gets more samples (default: 0.01).\n"
+		"                   Implies --aa.\n"
+		"  --integrator <name>\n"
+		"                   How rays are colored: whitted (default: Phong shading,\n"
+		"                   reflection and refraction) or path (path tracing)\n"
+		"  --spp <n>        Samples per pixel when path tracing, unless set by --aa\n"
+		"                   or --progressive instead (default: 16)\n"
+		"  --progressive <samples>\n"
+		"                   Render in passes: a coarse preview, then one per sample\n"
+		"                   per pixel, averaging them as they come in. Can't be\n"
+		"                   combined with --aa or --stream.\n"
+		"  --stream         Write tiles to the --out file as they finish, instead of\n"
+		"                   keeping the whole image in memory. The file must be a\n"
+		"                   .ppm. Implies --no-window.\n"
+		"  --resume         Carry on from where an interrupted render of the same\n"
+		"                   scene left off, rendering only what's missing. Starts\n"
+		"                   from scratch if there's nothing to resume.\n"
+		"  --checkpoint-interval <seconds>\n"
+		"                   How often to save progress for --resume (default: 60).\n"
+		"                   Saved next to the --out file, or in the renders\n"
+		"                   directory if there isn't one.\n"
+		"  --heatmap <file> Also save a heatmap of what each pixel cost to render\n"
+		"                   here, and every measure of it as floats to a .pfm file\n"
+		"                   of the same name. Can't be combined with\n"
+		"                   --progressive, --stream or --resume.\n"
+		"  --heatmap-of <measure>\n"
+		"                   Cost shown in the heatmap: time (default), tests\n"
+		"                   (BVH nodes and primitives tested) or shadow (rays)\n"
+		"  --no-window      Don't open a window (or initialize SDL at all)\n"
+		"  --profile <file> Write a Chrome trace of where the time went here (only\n"
+		"                   in builds with RAYTRACER_PROFILING on, which also print\n"
+		"                   a summary of it at the end)\n"
+		"  --help, -h       Print this message and exit\n";
+}
@@ -0,0 +1,64 @@
+#ifndef RAYTRACER_PARSECOMMANDLINE_HPP
+#define RAYTRACER_PARSECOMMANDLINE_HPP
+
+#include <string>
+#include <stdexcept>
+
+struct CommandLineOptions {
+	// empty if user should be prompted to pick a scene
+	std::string scene_filename;
+	// empty if user should be prompted to save once done (interactive mode).
+	// Otherwise the render is saved here and the program exits without reading
+	// any input (batch mode).
+	std::string output_filename;
+	// 0 means one per hardware thread
+	size_t thread_count = 0;
+	// instruction set for packet tracing: "auto", "avx2", "sse", "scalar" or "off"
+	// (trace rays one at a time)
+	std::string simd = "auto";
+	// anti-alias by sampling each pixel adaptively (see AdaptiveSampling)
+	bool antialias = false;
+	unsigned int aa_min_samples = 4;
+	unsigned int aa_max_samples = 64;
+	float aa_threshold = 0.01f;
+	// how rays are colored: "whitted" or "path" (see Integrator)
+	std::string integrator = "whitted";
+	// samples per pixel when path tracing without anti-aliasing or rendering
+	// progressively (which decide the number themselves), 0 if not given
+	unsigned int path_samples = 0;
+	// samples per pixel to render progressively, 0 to render in a single pass
+	unsigned int progressive_samples = 0;
+	// write tiles to output_filename (a .ppm) as they finish, instead of keeping
+	// the whole image in memory
+	bool stream = false;
+	// carry on from the checkpoint (or streamed image) left by an interrupted render
+	bool resume = false;
+	size_t checkpoint_interval_seconds = 60;
+	// where to save a heatmap of what each pixel cost to render, if not empty (see
+	// CostMap). Every measure of cost is also saved, as floats, to a .pfm file of
+	// the same name.
+	std::string heatmap_filename;
+	// measure shown in the heatmap: "time", "tests" or "shadow"
+	std::string heatmap_measure = "time";
+	bool show_window = true;
+	// where to write a Chrome trace of the run, if not empty. Only allowed in
+	// builds with RAYTRACER_PROFILING defined (see Profiler).
+	std::string profile_filename;
+	bool show_help = false;
+};
+
+// throws std::runtime_error describing the problem if arguments are invalid
+CommandLineOptions parseCommandLine(int argc, char** argv);
+
+// helpers for reading option values (also used by raytracer_bench), each throwing
+// std::runtime_error naming the option if its value is missing or invalid
+namespace cli {
+	// the value following argv[*i], moving *i on to it
+	std::string getOptionValue(int argc, char** argv, int* const& i);
+	size_t parseCount(const std::string& option, const std::string& value);
+	float parsePositiveFloat(const std::string& option, const std::string& value);
+}
+
+std::string getCommandLineUsage(const std::string& program_name);
+
+#endif //RAYTRACER_PARSECOMMANDLINE_HPP
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "parseFloat.hpp"
+
+bool parseFloat(
+	const char** const& cursor,
+	const char* const& end,
+	float* const& value
+) {
+	static const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const int max_exact_power = 22;
+	const uint64_t max_exact_mantissa = 1ull << 53;
+
+	const char* token = skipSpaces(*cursor, end);
+	const char* token_end = findTokenEnd(token, end);
+	if (token == token_end) {
+		return false;
+	}
+
+	const char* c = token;
+	bool is_negative = *c == '-';
+	if (*c == '-' || *c == '+') {
+		c++;
+	}
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digit_count = 0;
+	bool is_exact = true;
+	for (; c < token_end && isDigit(*c); c++, digit_count++) {
+		if (mantissa < max_exact_mantissa) {
+			mantissa = mantissa * 10 + (*c - '0');
+		} else {
+			is_exact = false;
+		}
+	}
+	if (c < token_end && *c == '.') {
+		for (c++; c < token_end && isDigit(*c); c++, digit_count++) {
+			if (mantissa < max_exact_mantissa) {
+				mantissa = mantissa * 10 + (*c - '0');
+				exponent--;
+			} else {
+				is_exact = false;
+			}
+		}
+	}
+	if (c < token_end && (*c == 'e' || *c == 'E')) {
+		c++;
+		bool is_exponent_negative = c < token_end && *c == '-';
+		if (c < token_end && (*c == '-' || *c == '+')) {
+			c++;
+		}
+		int written_exponent = 0;
+		int exponent_digit_count = 0;
+		for (; c < token_end && isDigit(*c); c++, exponent_digit_count++) {
+			written_exponent = std::min(written_exponent * 10 + (*c - '0'), 10000);
+		}
+		if (exponent_digit_count == 0) {
+			return false;
+		}
+		exponent += is_exponent_negative ? -written_exponent : written_exponent;
+	}
+
+	double parsed;
+	if (
+		c == token_end &&
+		digit_count > 0 &&
+		is_exact &&
+		mantissa <= max_exact_mantissa &&
+		exponent >= -max_exact_power &&
+		exponent <= max_exact_power
+	) {
+		// both operands are exact, so the one rounding happens in the division or
+		// multiplication, as it would in strtod
+		parsed = exponent < 0 ?
+			(double)mantissa / powers_of_ten[-exponent] :
+			(double)mantissa * powers_of_ten[exponent];
+		if (is_negative) {
+			parsed = -parsed;
+		}
+	} else {
+		// the file isn't null terminated, so copy the number out
+		char buffer[64];
+		size_t length = token_end - token;
+		if (length >= sizeof(buffer)) {
+			return false;
+		}
+		std::memcpy(buffer, token, length);
+		buffer[length] = '\0';
+		char* parsed_end;
+		parsed = std::strtod(buffer, &parsed_end);
+		if (parsed_end != buffer + length) {
+			return false;
+		}
+	}
+	*value = (float)parsed;
+	*cursor = token_end;
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef RAYTRACER_PARSEFLOAT_HPP
+#define RAYTRACER_PARSEFLOAT_HPP
+
+// Helpers for reading space-separated tokens out of a line, shared with loadObj.
+// Lines are split on newlines beforehand, so only spaces, tabs and carriage
+// returns separate tokens. (defined inline since they're called for every
+// character read)
+
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c)
+{
+	return (unsigned int)(c - '0') < 10;
+}
+
+// first character from cursor which isn't a space, or end
+inline const char* skipSpaces(const char* cursor, const char* const& end)
+{
+	while (cursor < end && isSpace(*cursor)) {
+		cursor++;
+	}
+	return cursor;
+}
+
+// first space from cursor, or end
+inline const char* findTokenEnd(const char* cursor, const char* const& end)
+{
+	while (cursor < end && !isSpace(*cursor)) {
+		cursor++;
+	}
+	return cursor;
+}
+
+// Parses the number at *cursor (after any spaces or tabs), which has to run up to
+// the next space, tab, carriage return or end, then advances *cursor past it.
+// Returns false, leaving *cursor alone, if there's no number there.
+//
+// Reads straight out of a buffer, which needn't be null terminated, without
+// allocating. Plain decimals which can be read exactly in double precision
+// (almost every number in a scene or .obj file) are converted directly, and
+// anything else with std::strtod.
+bool parseFloat(const char** const& cursor, const char* const& end, float* const& value);
+
+#endif //RAYTRACER_PARSEFLOAT_HPP
@@ -0,0 +1,176 @@
+#include <ostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "Profiler.hpp"
+
+namespace {
+	const size_t counter_count = (size_t)ProfileCounter::count;
+	const size_t stage_count = (size_t)ProfileStage::count;
+
+	const char* const counter_names[counter_count] = {
+		"sphere tests",
+		"plane tests",
+		"triangle tests"
+	};
+
+	const char* const stage_names[stage_count] = {
+		"load scene",
+		"load model",
+		"camera setup",
+		"build scene BVH",
+		"render tile",
+		"preview frame",
+		"write image",
+		"intersect",
+		"shade",
+		"shadow test"
+	};
+
+	// a single call to a stage, in nanoseconds since the profile began
+	struct TraceEvent {
+		ProfileStage stage;
+		int64_t start;
+		int64_t duration;
+	};
+
+	struct ThreadProfile {
+		size_t thread_index;
+		uint64_t counts[counter_count] = {};
+		uint64_t stage_calls[stage_count] = {};
+		int64_t stage_nanoseconds[stage_count] = {};
+		std::vector<TraceEvent> events;
+	};
+
+	// what the trace's times are measured from
+	const std::chrono::steady_clock::time_point profile_start =
+		std::chrono::steady_clock::now();
+
+	// profiles outlive their threads, so they can be reported once they're done
+	std::mutex profiles_mut;
+	std::vector<std::unique_ptr<ThreadProfile>> profiles;
+
+	ThreadProfile* addThreadProfile()
+	{
+		std::lock_guard<std::mutex> lock(profiles_mut);
+		profiles.emplace_back(new ThreadProfile());
+		profiles.back()->thread_index = profiles.size() - 1;
+		return profiles.back().get();
+	}
+
+	ThreadProfile& getThreadProfile()
+	{
+		static thread_local ThreadProfile* profile = addThreadProfile();
+		return *profile;
+	}
+
+	int64_t getNanoseconds(const std::chrono::steady_clock::duration& duration)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+	}
+}
+
+#ifdef RAYTRACER_PROFILING
+const bool Profiler::is_enabled = true;
+#else
+const bool Profiler::is_enabled = false;
+#endif
+
+void Profiler::addCount(const ProfileCounter& counter, const uint64_t& amount)
+{
+	getThreadProfile().counts[(size_t)counter] += amount;
+}
+
+void Profiler::addStageTime(
+	const ProfileStage& stage,
+	const std::chrono::steady_clock::time_point& start,
+	const std::chrono::steady_clock::time_point& end
+) {
+	ThreadProfile& profile = getThreadProfile();
+	int64_t duration = getNanoseconds(end - start);
+	profile.stage_calls[(size_t)stage]++;
+	profile.stage_nanoseconds[(size_t)stage] += duration;
+	if (stage < ProfileStage::intersect) {
+		profile.events.push_back({stage, getNanoseconds(start - profile_start), duration});
+	}
+}
+
+void Profiler::writeSummary(std::ostream& out)
+{
+	uint64_t counts[counter_count] = {};
+	uint64_t stage_calls[stage_count] = {};
+	int64_t stage_nanoseconds[stage_count] = {};
+	std::lock_guard<std::mutex> lock(profiles_mut);
+	for (const std::unique_ptr<ThreadProfile>& profile : profiles) {
+		for (size_t i = 0; i < counter_count; i++) {
+			counts[i] += profile->counts[i];
+		}
+		for (size_t i = 0; i < stage_count; i++) {
+			stage_calls[i] += profile->stage_calls[i];
+			stage_nanoseconds[i] += profile->stage_nanoseconds[i];
+		}
+	}
+
+	std::ios::fmtflags flags = out.flags();
+	out << "Profile over " << profiles.size() << " threads (stage times overlap "
+		<< "where stages nest, and add up over threads):" << std::endl;
+	out << std::left << std::setw(18) << "stage" << std::right << std::setw(14)
+		<< "calls" << std::setw(14) << "total ms" << std::setw(14) << "mean us"
+		<< std::endl;
+	out << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < stage_count; i++) {
+		if (stage_calls[i] == 0) {
+			continue;
+		}
+		out << std::left << std::setw(18) << stage_names[i] << std::right
+			<< std::setw(14) << stage_calls[i]
+			<< std::setw(14) << stage_nanoseconds[i] / 1e6
+			<< std::setw(14) << stage_nanoseconds[i] / 1e3 / stage_calls[i] << std::endl;
+	}
+	out << std::left << std::setw(18) << "counter" << std::right << std::setw(14)
+		<< "count" << std::endl;
+	for (size_t i = 0; i < counter_count; i++) {
+		out << std::left << std::setw(18) << counter_names[i] << std::right
+			<< std::setw(14) << counts[i] << std::endl;
+	}
+	out.flags(flags);
+}
+
+bool Profiler::writeTrace(const std::string& filename)
+{
+	std::ofstream file(filename);
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	bool is_first = true;
+	std::lock_guard<std::mutex> lock(profiles_mut);
+	for (const std::unique_ptr<ThreadProfile>& profile : profiles) {
+		for (const TraceEvent& event : profile->events) {
+			// complete events, with times in microseconds
+			file << (is_first ? "" : ",") << std::endl
+				<< "{\"name\": \"" << stage_names[(size_t)event.stage]
+				<< "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << profile->thread_index
+				<< ", \"ts\": " << event.start / 1000
+				<< "." << std::setfill('0') << std::setw(3) << event.start % 1000
+				<< ", \"dur\": " << event.duration / 1000
+				<< "." << std::setw(3) << event.duration % 1000 << std::setfill(' ') << "}";
+			is_first = false;
+		}
+	}
+	file << std::endl << "]}" << std::endl;
+	file.close();
+	return !file.fail();
+}
+
+ProfileScope::ProfileScope(const ProfileStage& stage) : stage(stage),
+    start(std::chrono::steady_clock::now())
+{}
+
+ProfileScope::~ProfileScope()
+{
+	Profiler::addStageTime(this->stage, this->start, std::chrono::steady_clock::now());
+}
@@ -0,0 +1,85 @@
+#ifndef RAYTRACER_PROFILER_HPP
+#define RAYTRACER_PROFILER_HPP
+
+#include <ostream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+// Optional instrumentation, for finding out where the time in a render goes.
+// Only compiled in when RAYTRACER_PROFILING is defined (configure with
+// -DRAYTRACER_PROFILING=ON); otherwise the PROFILE_ macros below expand to
+// nothing, and the Profiler never has anything to report.
+//
+// PROFILE_COUNT adds to one of the counters, and PROFILE_SCOPE times the rest of
+// the enclosing block as one of the stages. Each thread keeps counts and times of
+// its own, without locking, which are only added up when reported, once every
+// other thread has finished. Stages with a call for every ray (or more) are only
+// totalled; the rest are also recorded one by one, for a Chrome trace.
+//
+// Stages nest (shading includes the shadow tests it makes, for instance), so
+// their times overlap.
+
+enum class ProfileCounter {
+	sphere_tests,
+	plane_tests,
+	triangle_tests,
+	count
+};
+
+enum class ProfileStage {
+	load_scene,
+	load_model,
+	camera_setup,
+	build_scene_bvh,
+	render_tile,
+	preview_frame,
+	write_image,
+	// the stages from here on are only totalled
+	intersect,
+	shade,
+	shadow_test,
+	count
+};
+
+class Profiler {
+public:
+	static const bool is_enabled;
+	static void addCount(const ProfileCounter& counter, const uint64_t& amount);
+	static void addStageTime(
+		const ProfileStage& stage,
+		const std::chrono::steady_clock::time_point& start,
+		const std::chrono::steady_clock::time_point& end
+	);
+	// table of the counters, and calls and time spent in each stage, over every
+	// thread. Must not be called while other threads are still profiling.
+	static void writeSummary(std::ostream& out);
+	// writes the stages recorded one by one as Chrome trace_event JSON (which
+	// chrome://tracing and Perfetto open), returning false if it couldn't. Must not
+	// be called while other threads are still profiling.
+	static bool writeTrace(const std::string& filename);
+};
+
+// adds the time from its construction to its destruction to stage
+class ProfileScope {
+private:
+	ProfileStage stage;
+	std::chrono::steady_clock::time_point start;
+public:
+	explicit ProfileScope(const ProfileStage& stage);
+	~ProfileScope();
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#ifdef RAYTRACER_PROFILING
+#define PROFILE_COUNT(counter, amount) \
+	Profiler::addCount(ProfileCounter::counter, amount)
+#define PROFILE_SCOPE(stage) ProfileScope profile_scope(ProfileStage::stage)
+#else
+#define PROFILE_COUNT(counter, amount)
+#define PROFILE_SCOPE(stage)
+#endif
+
+
+#endif //RAYTRACER_PROFILER_HPP
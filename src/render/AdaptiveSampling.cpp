@@ -0,0 +1,38 @@
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cmath>
+
+#include <src/hashBits.hpp>
+
+#include "AdaptiveSampling.hpp"
+
+namespace {
+	// index-th element of the van der Corput sequence in base
+	float radicalInverse(unsigned int index, const unsigned int& base)
+	{
+		float inverse_base = 1.0f / base;
+		float digit_weight = inverse_base;
+		float result = 0.0f;
+		while (index > 0) {
+			result += (index % base) * digit_weight;
+			index /= base;
+			digit_weight *= inverse_base;
+		}
+		return result;
+	}
+}
+
+glm::vec2 AdaptiveSampling::getSampleOffset(
+	const unsigned int& x,
+	const unsigned int& y,
+	const unsigned int& sample_index
+) {
+	uint32_t pixel_hash = mixBits(x * 0x9e3779b9u ^ mixBits(y));
+	glm::vec2 shift(toUnitFloat(pixel_hash), toUnitFloat(mixBits(pixel_hash)));
+	glm::vec2 offset(
+		radicalInverse(sample_index, 2) + shift.x,
+		radicalInverse(sample_index, 3) + shift.y
+	);
+	// wrapped back into [0, 1)
+	return offset - glm::floor(offset);
+}
@@ -0,0 +1,32 @@
+#ifndef RAYTRACER_ADAPTIVESAMPLING_HPP
+#define RAYTRACER_ADAPTIVESAMPLING_HPP
+
+#include <glm/glm.hpp>
+
+// Settings for adaptive anti-aliasing (see Renderer::setAdaptiveSampling). Each
+// pixel is first given min_samples samples spread over its area. While the
+// standard error of their mean color is above threshold in any channel, more are
+// added, a packet's worth at a time, up to max_samples. So flat areas stop at
+// min_samples, and only edges and other detail get refined.
+//
+// Sample positions follow a Halton sequence, shifted by a different amount for
+// each pixel so neighbouring pixels don't sample in lockstep. They only depend on
+// the pixel, so renders come out the same on any number of threads.
+
+struct AdaptiveSampling {
+	// at least 2, so the error can be estimated
+	unsigned int min_samples = 4;
+	unsigned int max_samples = 64;
+	float threshold = 0.01f;
+
+	// position of sample number sample_index within pixel (x, y), with each
+	// coordinate in [0, 1)
+	static glm::vec2 getSampleOffset(
+		const unsigned int& x,
+		const unsigned int& y,
+		const unsigned int& sample_index
+	);
+};
+
+
+#endif //RAYTRACER_ADAPTIVESAMPLING_HPP
@@ -0,0 +1,134 @@
+#include <boost/filesystem.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "Checkpoint.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace {
+	// start of every checkpoint file. Followed by the scene hash (uint64_t), image
+	// width, height, tile size and tile count (uint32_t), the render settings
+	// (integrator, min and max samples as uint32_t, then the sample threshold as a
+	// float), a byte per tile (1 if complete), then the image. Then, the number of
+	// tile sample counts (uint32_t, 0 unless progressive), and if there are any,
+	// the counts and the color sums.
+	const char checkpoint_magic[] = "RTCHECK3";
+
+	void writeSettings(std::ofstream* const& file, const RenderSettings& settings)
+	{
+		uint32_t counts[3] = {
+			settings.integrator,
+			settings.min_samples,
+			settings.max_samples
+		};
+		file->write((const char*)counts, sizeof(counts));
+		file->write(
+			(const char*)&settings.sample_threshold,
+			sizeof(settings.sample_threshold)
+		);
+	}
+
+	void readSettings(std::ifstream* const& file, RenderSettings* const& settings)
+	{
+		uint32_t counts[3] = {0, 0, 0};
+		file->read((char*)counts, sizeof(counts));
+		file->read((char*)&settings->sample_threshold, sizeof(settings->sample_threshold));
+		settings->integrator = counts[0];
+		settings->min_samples = counts[1];
+		settings->max_samples = counts[2];
+	}
+}
+
+bool Checkpoint::save(const std::string& filename) const
+{
+	std::string temporary_filename = filename + ".tmp";
+	{
+		std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+		uint32_t header[4] = {
+			this->image_width,
+			this->image_height,
+			this->tile_size,
+			(uint32_t)this->completed_tiles.size()
+		};
+		std::vector<char> tile_flags(
+			this->completed_tiles.begin(),
+			this->completed_tiles.end()
+		);
+		file.write(checkpoint_magic, sizeof(checkpoint_magic) - 1);
+		file.write((const char*)&this->scene_hash, sizeof(this->scene_hash));
+		file.write((const char*)header, sizeof(header));
+		writeSettings(&file, this->settings);
+		file.write(tile_flags.data(), tile_flags.size());
+		file.write((const char*)this->image.data(), this->image.size());
+		uint32_t tile_sample_count_count = this->tile_sample_counts.size();
+		file.write((const char*)&tile_sample_count_count, sizeof(tile_sample_count_count));
+		if (tile_sample_count_count > 0) {
+			file.write(
+				(const char*)this->tile_sample_counts.data(),
+				tile_sample_count_count * sizeof(uint32_t)
+			);
+			file.write(
+				(const char*)this->color_sums.data(),
+				this->color_sums.size() * sizeof(float)
+			);
+		}
+		file.close();
+		if (!file) {
+			return false;
+		}
+	}
+	boost::system::error_code error;
+	fs::rename(temporary_filename, filename, error);
+	return !error;
+}
+
+Checkpoint Checkpoint::load(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open checkpoint " + filename + ".");
+	}
+
+	Checkpoint checkpoint;
+	char magic[sizeof(checkpoint_magic) - 1];
+	uint32_t header[4];
+	file.read(magic, sizeof(magic));
+	file.read((char*)&checkpoint.scene_hash, sizeof(checkpoint.scene_hash));
+	file.read((char*)header, sizeof(header));
+	readSettings(&file, &checkpoint.settings);
+	if (!file || std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0) {
+		throw std::runtime_error(filename + " isn't a render checkpoint.");
+	}
+	checkpoint.image_width = header[0];
+	checkpoint.image_height = header[1];
+	checkpoint.tile_size = header[2];
+
+	std::vector<char> tile_flags(header[3]);
+	checkpoint.image.resize((size_t)header[0] * header[1] * 3);
+	file.read(tile_flags.data(), tile_flags.size());
+	file.read((char*)checkpoint.image.data(), checkpoint.image.size());
+	uint32_t tile_sample_count_count = 0;
+	file.read((char*)&tile_sample_count_count, sizeof(tile_sample_count_count));
+	if (file && tile_sample_count_count > 0) {
+		checkpoint.tile_sample_counts.resize(tile_sample_count_count);
+		checkpoint.color_sums.resize(checkpoint.image.size());
+		file.read(
+			(char*)checkpoint.tile_sample_counts.data(),
+			tile_sample_count_count * sizeof(uint32_t)
+		);
+		file.read(
+			(char*)checkpoint.color_sums.data(),
+			checkpoint.color_sums.size() * sizeof(float)
+		);
+	}
+	if (!file) {
+		throw std::runtime_error("Checkpoint " + filename + " is truncated.");
+	}
+	checkpoint.completed_tiles.assign(tile_flags.begin(), tile_flags.end());
+	return checkpoint;
+}
@@ -0,0 +1,43 @@
+#ifndef RAYTRACER_CHECKPOINT_HPP
+#define RAYTRACER_CHECKPOINT_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include "RenderSettings.hpp"
+
+// Snapshot of a render in progress, saved periodically so an interrupted render
+// can carry on where it left off (see Renderer::getCheckpoint and
+// Renderer::restoreCheckpoint).
+//
+// The scene file's hash (see hashFile) is stored alongside, so a checkpoint is never resumed
+// into a render of a scene that has since been edited, as are the render's
+// settings, so it's never finished with different ones.
+
+struct Checkpoint {
+	uint64_t scene_hash = 0;
+	unsigned int image_width = 0;
+	unsigned int image_height = 0;
+	unsigned int tile_size = 0;
+	RenderSettings settings;
+	// one per tile, in TileScheduler::makeTiles order
+	std::vector<bool> completed_tiles;
+	// RGB, in image order. Black outside completed tiles.
+	std::vector<unsigned char> image;
+	// only for progressive renders (empty otherwise): samples accumulated in each
+	// tile, and the sum of every pixel's samples (RGB, in image order)
+	std::vector<uint32_t> tile_sample_counts;
+	std::vector<float> color_sums;
+
+	// writes to a temporary file first, then moves it over filename, so a
+	// process killed part way through leaves the previous checkpoint intact.
+	// Returns false if the file couldn't be written.
+	bool save(const std::string& filename) const;
+	// throws std::runtime_error if filename isn't a valid checkpoint
+	static Checkpoint load(const std::string& filename);
+};
+
+
+#endif //RAYTRACER_CHECKPOINT_HPP
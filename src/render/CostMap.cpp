@@ -0,0 +1,134 @@
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "CostMap.hpp"
+
+namespace {
+	float getMeasure(const PixelCost& cost, const CostMeasure& measure)
+	{
+		switch (measure) {
+			case CostMeasure::intersection_tests:
+				return cost.intersection_tests;
+			case CostMeasure::shadow_rays:
+				return cost.shadow_rays;
+			default:
+				return cost.nanoseconds;
+		}
+	}
+
+	// color of a heatmap at position in [0, 1]
+	glm::vec3 getHeatColor(const float& position)
+	{
+		static const glm::vec3 stops[] = {
+			glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f),
+			glm::vec3(1.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, 0.0f),
+			glm::vec3(1.0f, 1.0f, 1.0f)
+		};
+		const int last_stop = sizeof(stops) / sizeof(stops[0]) - 1;
+		float scaled = std::min(std::max(position, 0.0f), 1.0f) * last_stop;
+		int stop = std::min((int)scaled, last_stop - 1);
+		float weight = scaled - stop;
+		return stops[stop] * (1.0f - weight) + stops[stop + 1] * weight;
+	}
+}
+
+CostMap::CostMap(
+	const unsigned int& image_width,
+	const unsigned int& image_height
+) : image_width(image_width),
+    image_height(image_height),
+    costs(image_width * image_height)
+{}
+
+void CostMap::addCost(
+	const unsigned int& x,
+	const unsigned int& y,
+	const PixelCost& cost
+) {
+	PixelCost& pixel_cost = this->costs[y * this->image_width + x];
+	pixel_cost.nanoseconds += cost.nanoseconds;
+	pixel_cost.intersection_tests += cost.intersection_tests;
+	pixel_cost.shadow_rays += cost.shadow_rays;
+}
+
+const PixelCost& CostMap::getCost(const unsigned int& x, const unsigned int& y) const
+{
+	return this->costs[y * this->image_width + x];
+}
+
+float CostMap::getHighCost(const CostMeasure& measure) const
+{
+	if (this->costs.empty()) {
+		return 0.0f;
+	}
+	std::vector<float> values;
+	values.reserve(this->costs.size());
+	for (const PixelCost& cost : this->costs) {
+		values.push_back(getMeasure(cost, measure));
+	}
+	std::vector<float>::iterator high = values.begin() + values.size() * 99 / 100;
+	std::nth_element(values.begin(), high, values.end());
+	return *high;
+}
+
+std::vector<unsigned char> CostMap::getHeatmap(
+	const CostMeasure& measure,
+	const float& high_cost
+) const
+{
+	std::vector<unsigned char> pixels(this->costs.size() * 3);
+	for (size_t i = 0, len = this->costs.size(); i < len; i++) {
+		float value = getMeasure(this->costs[i], measure);
+		glm::vec3 color = getHeatColor(high_cost > 0.0f ? value / high_cost : 0.0f);
+		pixels[i * 3] = (unsigned char)round(255.0 * color.r);
+		pixels[i * 3 + 1] = (unsigned char)round(255.0 * color.g);
+		pixels[i * 3 + 2] = (unsigned char)round(255.0 * color.b);
+	}
+	return pixels;
+}
+
+bool CostMap::writeFloats(const std::string& filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	// floats are written in the machine's byte order, which a negative scale
+	// marks as little-endian
+	uint16_t byte_order_check = 1;
+	unsigned char first_byte;
+	std::memcpy(&first_byte, &byte_order_check, 1);
+	file << "PF\n" << this->image_width << " " << this->image_height << "\n"
+		<< (first_byte == 1 ? "-1.0" : "1.0") << "\n";
+
+	std::vector<float> row(this->image_width * 3);
+	// rows go from the bottom of the image to the top
+	for (unsigned int y = this->image_height; y-- > 0;) {
+		for (unsigned int x = 0; x < this->image_width; x++) {
+			const PixelCost& cost = this->getCost(x, y);
+			row[x * 3] = cost.nanoseconds;
+			row[x * 3 + 1] = cost.intersection_tests;
+			row[x * 3 + 2] = cost.shadow_rays;
+		}
+		file.write((const char*)row.data(), row.size() * sizeof(float));
+	}
+	file.close();
+	return !file.fail();
+}
+
+const char* CostMap::getMeasureName(const CostMeasure& measure)
+{
+	switch (measure) {
+		case CostMeasure::intersection_tests:
+			return "intersection tests";
+		case CostMeasure::shadow_rays:
+			return "shadow rays";
+		default:
+			return "nanoseconds";
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef RAYTRACER_COSTMAP_HPP
+#define RAYTRACER_COSTMAP_HPP
+
+#include <string>
+#include <vector>
+
+// What it took to render a pixel. Floats, since work shared by several pixels
+// (like intersecting a packet of rays) is split evenly between them.
+struct PixelCost {
+	float nanoseconds = 0.0f;
+	// BVH nodes visited plus primitives tested, in the scene's BVH and those of
+	// any models reached. (Unbounded objects, like planes, are tested outside of
+	// any BVH, so aren't counted.)
+	float intersection_tests = 0.0f;
+	float shadow_rays = 0.0f;
+};
+
+enum class CostMeasure {
+	time,
+	intersection_tests,
+	shadow_rays
+};
+
+// Per pixel render costs, recorded by a Renderer, for finding the parts of a scene
+// which take the most time.
+//
+// Each pixel is only written by the worker rendering its tile, without any
+// locking, so the map mustn't be read until the render is done.
+
+class CostMap {
+private:
+	unsigned int image_width;
+	unsigned int image_height;
+	// in image order
+	std::vector<PixelCost> costs;
+public:
+	CostMap(const unsigned int& image_width, const unsigned int& image_height);
+	void addCost(const unsigned int& x, const unsigned int& y, const PixelCost& cost);
+	const PixelCost& getCost(const unsigned int& x, const unsigned int& y) const;
+	// value of measure below which all but 1 in 100 pixels fall, so a few extreme
+	// pixels don't wash out the rest of a heatmap
+	float getHighCost(const CostMeasure& measure) const;
+	// RGB heatmap of measure, running from black (nothing) through blue, red and
+	// yellow to white (high_cost or more)
+	std::vector<unsigned char> getHeatmap(
+		const CostMeasure& measure,
+		const float& high_cost
+	) const;
+	// writes every measure as a 3 channel PFM (Portable Float Map), with time in
+	// red, intersection tests in green and shadow rays in blue. Returns false if
+	// it couldn't be written.
+	bool writeFloats(const std::string& filename) const;
+	static const char* getMeasureName(const CostMeasure& measure);
+};
+
+
+#endif //RAYTRACER_COSTMAP_HPP
@@ -0,0 +1,249 @@
+#include <glm/glm.hpp>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include "TileScheduler.hpp"
+#include "Framebuffer.hpp"
+
+Framebuffer::Framebuffer(
+	unsigned int image_width,
+	unsigned int image_height,
+	unsigned int tile_size,
+	bool is_accumulating
+) : image_width(image_width),
+    image_height(image_height),
+    tile_size(tile_size),
+    tile_columns((image_width + tile_size - 1) / tile_size)
+{
+	this->pixels.assign((size_t)image_width * image_height * image_channels, 0);
+	unsigned int tile_rows = (image_height + tile_size - 1) / tile_size;
+	this->tile_count = (size_t)this->tile_columns * tile_rows;
+	this->sequences.reset(new std::atomic<uint32_t>[this->tile_count]);
+	for (size_t i = 0; i < this->tile_count; i++) {
+		this->sequences[i] = 0;
+	}
+	if (is_accumulating) {
+		this->color_sums.assign((size_t)image_width * image_height * image_channels, 0.0f);
+		this->tile_sample_counts.assign(this->tile_count, 0);
+	}
+}
+
+size_t Framebuffer::getTileIndex(const Tile& tile) const
+{
+	return (tile.y / this->tile_size) * this->tile_columns + tile.x / this->tile_size;
+}
+
+void Framebuffer::copyTileIn(const Tile& tile, const unsigned char* const& tile_pixels)
+{
+	size_t row_size = tile.width * image_channels;
+	for (unsigned int row = 0; row < tile.height; row++) {
+		size_t first_pixel = (size_t)(tile.y + row) * this->image_width + tile.x;
+		std::copy_n(
+			tile_pixels + row * row_size,
+			row_size,
+			this->pixels.begin() + first_pixel * image_channels
+		);
+	}
+}
+
+void Framebuffer::copyTileOut(const Tile& tile, unsigned char* const& tile_pixels) const
+{
+	size_t row_size = tile.width * image_channels;
+	for (unsigned int row = 0; row < tile.height; row++) {
+		size_t first_pixel = (size_t)(tile.y + row) * this->image_width + tile.x;
+		std::copy_n(
+			this->pixels.begin() + first_pixel * image_channels,
+			row_size,
+			tile_pixels + row * row_size
+		);
+	}
+}
+
+void Framebuffer::resolveTile(const Tile& tile, const uint32_t& sample_count)
+{
+	// (the same rounding as Renderer::setPixel, so one sample shows as it would
+	// have without accumulating)
+	for (unsigned int row = 0; row < tile.height; row++) {
+		size_t first = ((size_t)(tile.y + row) * this->image_width + tile.x) * image_channels;
+		for (size_t i = first, end = first + tile.width * image_channels; i < end; i++) {
+			this->pixels[i] =
+				(unsigned char)std::round(255.0 * this->color_sums[i] / sample_count);
+		}
+	}
+}
+
+template <typename Copy>
+bool Framebuffer::readSequenced(const Tile& tile, const Copy& copy) const
+{
+	const std::atomic<uint32_t>& sequence = this->sequences[this->getTileIndex(tile)];
+	while (true) {
+		uint32_t start_sequence = sequence.load(std::memory_order_acquire);
+		if (start_sequence == 0) {
+			return false;
+		}
+		if (start_sequence % 2 == 1) {
+			// a writer is part way through, which won't take long
+			std::this_thread::yield();
+			continue;
+		}
+		copy();
+		// keeps the copy from finishing after the sequence is checked again
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) == start_sequence) {
+			return true;
+		}
+	}
+}
+
+template <typename Write>
+void Framebuffer::writeSequenced(const Tile& tile, const Write& write)
+{
+	std::atomic<uint32_t>& sequence = this->sequences[this->getTileIndex(tile)];
+	uint32_t start_sequence = sequence.load(std::memory_order_relaxed);
+	// odd until the write is done. The fence keeps the write from starting before
+	// readers can see that.
+	sequence.store(start_sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	write();
+	sequence.store(start_sequence + 2, std::memory_order_release);
+}
+
+void Framebuffer::writeTile(const Tile& tile, const unsigned char* const& tile_pixels)
+{
+	this->writeSequenced(tile, [&]() {
+		this->copyTileIn(tile, tile_pixels);
+	});
+}
+
+bool Framebuffer::readTile(const Tile& tile, unsigned char* const& tile_pixels) const
+{
+	return this->readSequenced(tile, [&]() {
+		this->copyTileOut(tile, tile_pixels);
+	});
+}
+
+void Framebuffer::accumulateTile(const Tile& tile, const glm::vec3* const& tile_colors)
+{
+	uint32_t& sample_count = this->tile_sample_counts[this->getTileIndex(tile)];
+	this->writeSequenced(tile, [&]() {
+		for (unsigned int row = 0; row < tile.height; row++) {
+			size_t first_pixel = (size_t)(tile.y + row) * this->image_width + tile.x;
+			float* sums = &this->color_sums[first_pixel * image_channels];
+			const glm::vec3* colors = tile_colors + row * tile.width;
+			for (unsigned int column = 0; column < tile.width; column++) {
+				sums[column * image_channels] += colors[column].r;
+				sums[column * image_channels + 1] += colors[column].g;
+				sums[column * image_channels + 2] += colors[column].b;
+			}
+		}
+		sample_count++;
+		this->resolveTile(tile, sample_count);
+	});
+}
+
+void Framebuffer::restoreTile(
+	const Tile& tile,
+	const float* const& tile_color_sums,
+	const uint32_t& sample_count
+) {
+	this->writeSequenced(tile, [&]() {
+		size_t row_size = tile.width * image_channels;
+		for (unsigned int row = 0; row < tile.height; row++) {
+			size_t first_pixel = (size_t)(tile.y + row) * this->image_width + tile.x;
+			std::copy_n(
+				tile_color_sums + row * row_size,
+				row_size,
+				this->color_sums.begin() + first_pixel * image_channels
+			);
+		}
+		this->tile_sample_counts[this->getTileIndex(tile)] = sample_count;
+		this->resolveTile(tile, sample_count);
+	});
+}
+
+uint32_t Framebuffer::getTileSampleCount(const Tile& tile) const
+{
+	if (this->tile_sample_counts.empty()) {
+		return 0;
+	}
+	uint32_t sample_count = 0;
+	this->readSequenced(tile, [&]() {
+		sample_count = this->tile_sample_counts[this->getTileIndex(tile)];
+	});
+	return sample_count;
+}
+
+std::vector<float> Framebuffer::copyColorSums(
+	std::vector<uint32_t>* const& tile_sample_counts
+) const
+{
+	std::vector<float> color_sums(this->color_sums.size(), 0.0f);
+	tile_sample_counts->assign(this->tile_count, 0);
+
+	std::vector<Tile> tiles =
+		TileScheduler::makeTiles(this->image_width, this->image_height, this->tile_size);
+	for (const Tile& tile : tiles) {
+		size_t tile_index = this->getTileIndex(tile);
+		this->readSequenced(tile, [&]() {
+			size_t row_size = tile.width * image_channels;
+			for (unsigned int row = 0; row < tile.height; row++) {
+				size_t first = ((size_t)(tile.y + row) * this->image_width + tile.x) *
+					image_channels;
+				std::copy_n(
+					this->color_sums.begin() + first,
+					row_size,
+					color_sums.begin() + first
+				);
+			}
+			(*tile_sample_counts)[tile_index] = this->tile_sample_counts[tile_index];
+		});
+	}
+	return color_sums;
+}
+
+bool Framebuffer::isTileWritten(const Tile& tile) const
+{
+	return this->sequences[this->getTileIndex(tile)].load(std::memory_order_acquire) != 0;
+}
+
+std::vector<unsigned char> Framebuffer::copyImage(
+	std::vector<bool>* const& completed_tiles
+) const
+{
+	std::vector<unsigned char> image(this->pixels.size(), 0);
+	if (completed_tiles) {
+		completed_tiles->assign(this->tile_count, false);
+	}
+
+	std::vector<unsigned char> tile_pixels(this->tile_size * this->tile_size * image_channels);
+	std::vector<Tile> tiles =
+		TileScheduler::makeTiles(this->image_width, this->image_height, this->tile_size);
+	for (const Tile& tile : tiles) {
+		if (!this->readTile(tile, tile_pixels.data())) {
+			continue;
+		}
+		if (completed_tiles) {
+			(*completed_tiles)[this->getTileIndex(tile)] = true;
+		}
+		size_t row_size = tile.width * image_channels;
+		for (unsigned int row = 0; row < tile.height; row++) {
+			size_t first_pixel = (size_t)(tile.y + row) * this->image_width + tile.x;
+			std::copy_n(
+				tile_pixels.begin() + row * row_size,
+				row_size,
+				image.begin() + first_pixel * image_channels
+			);
+		}
+	}
+	return image;
+}
+
+const std::vector<unsigned char>& Framebuffer::getPixels() const
+{
+	return this->pixels;
+}
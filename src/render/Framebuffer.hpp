@@ -0,0 +1,100 @@
+#ifndef RAYTRACER_FRAMEBUFFER_HPP
+#define RAYTRACER_FRAMEBUFFER_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "TileScheduler.hpp"
+
+// RGB image shared between the workers rendering it and any number of readers
+// (the preview, snapshots, checkpoints), none of which ever wait on each other.
+//
+// Workers render a tile into a buffer of their own, then publish it whole with
+// writeTile. Each tile is guarded by a sequence lock: its counter is odd while
+// the tile is being copied in, and goes up by two with every write. Readers copy
+// a tile and check the counter didn't change in the meantime, trying again if it
+// did. Publishing a tile is a single short copy, so retries are rare and cheap,
+// and a copied tile is always entirely from one write.
+//
+// Only one thread may write a given tile at a time (the TileScheduler only hands
+// each tile to one worker).
+//
+// For progressive renders, a framebuffer can also accumulate samples: the sum of
+// every sample's color, in floating point, and how many samples each tile has
+// had. Accumulating a tile's samples updates its sums and its RGB pixels (their
+// mean) together, under the same sequence lock.
+
+class Framebuffer {
+private:
+	unsigned int image_width;
+	unsigned int image_height;
+	unsigned int tile_size;
+	unsigned int tile_columns;
+	std::vector<unsigned char> pixels;
+	// RGB, in image order. Empty unless accumulating.
+	std::vector<float> color_sums;
+	// one per tile
+	std::vector<uint32_t> tile_sample_counts;
+	// one per tile; 0 until first written, odd while being written
+	std::unique_ptr<std::atomic<uint32_t>[]> sequences;
+	size_t tile_count;
+
+	// copies tile's rows between pixels and a tightly packed buffer
+	void copyTileIn(const Tile& tile, const unsigned char* const& tile_pixels);
+	void copyTileOut(const Tile& tile, unsigned char* const& tile_pixels) const;
+	// sets the tile's pixels to the mean of its accumulated samples
+	void resolveTile(const Tile& tile, const uint32_t& sample_count);
+	// runs copy until it completes without the tile being written in the meantime.
+	// Returns false without running it if the tile has never been written.
+	template <typename Copy>
+	bool readSequenced(const Tile& tile, const Copy& copy) const;
+	// runs write, with readers kept from seeing the tile part way through
+	template <typename Write>
+	void writeSequenced(const Tile& tile, const Write& write);
+public:
+	static const int image_channels = 3;
+	Framebuffer(
+		unsigned int image_width,
+		unsigned int image_height,
+		unsigned int tile_size,
+		bool is_accumulating = false
+	);
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+	// index of tile in TileScheduler::makeTiles order
+	size_t getTileIndex(const Tile& tile) const;
+	// tile_pixels holds the tile's RGB rows, tightly packed
+	void writeTile(const Tile& tile, const unsigned char* const& tile_pixels);
+	// copies tile into tile_pixels (tightly packed) if it has been written.
+	// Returns false, leaving tile_pixels alone, if it hasn't.
+	bool readTile(const Tile& tile, unsigned char* const& tile_pixels) const;
+	bool isTileWritten(const Tile& tile) const;
+	// adds a sample for each of the tile's pixels (tile_colors is tightly packed),
+	// and shows the new mean. Only for accumulating framebuffers.
+	void accumulateTile(const Tile& tile, const glm::vec3* const& tile_colors);
+	// replaces the tile's sums (RGB, tightly packed) and sample count, e.g. with
+	// those of a checkpoint
+	void restoreTile(
+		const Tile& tile,
+		const float* const& tile_color_sums,
+		const uint32_t& sample_count
+	);
+	// samples accumulated for every pixel of tile (0 if not accumulating)
+	uint32_t getTileSampleCount(const Tile& tile) const;
+	// copies the sums of every pixel, in image order, and sets tile_sample_counts
+	// to the number of samples summed in each tile
+	std::vector<float> copyColorSums(std::vector<uint32_t>* const& tile_sample_counts) const;
+	// copies the whole image, in image order, with tiles never written left black.
+	// If completed_tiles isn't nullptr, it's set to whether each tile was written.
+	std::vector<unsigned char> copyImage(
+		std::vector<bool>* const& completed_tiles = nullptr
+	) const;
+	// the image itself, only safe to read while nothing is writing to it
+	const std::vector<unsigned char>& getPixels() const;
+};
+
+
+#endif //RAYTRACER_FRAMEBUFFER_HPP
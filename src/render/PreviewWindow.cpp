@@ -0,0 +1,166 @@
+#include <SDL2/SDL.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <src/profiling/Profiler.hpp>
+
+#include "TileScheduler.hpp"
+#include "Framebuffer.hpp"
+#include "Renderer.hpp"
+#include "PreviewWindow.hpp"
+
+PreviewWindow::PreviewWindow(Renderer& renderer, unsigned int refresh_rate)
+	: renderer(renderer), refresh_rate(refresh_rate), stopping(false), closed(false)
+{
+	this->stats.refresh_rate = refresh_rate;
+	unsigned int tile_size = renderer.getTileSize();
+	this->tile_pixels.resize(tile_size * tile_size * Renderer::image_channels);
+	renderer.attachPreview();
+	this->thread = std::thread(&PreviewWindow::run, this);
+}
+
+PreviewWindow::~PreviewWindow()
+{
+	this->close();
+}
+
+bool PreviewWindow::isClosed() const
+{
+	return this->closed;
+}
+
+void PreviewWindow::close()
+{
+	this->stopping = true;
+	if (this->thread.joinable()) {
+		this->thread.join();
+	}
+}
+
+PreviewStats PreviewWindow::getStats() const
+{
+	return this->stats;
+}
+
+void PreviewWindow::run()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	unsigned int image_width = this->renderer.getImageWidth();
+	unsigned int image_height = this->renderer.getImageHeight();
+
+	// SDL setup inspired by:
+	// https://stackoverflow.com/a/35989490/4956731
+	// (the window is created here since its events have to be polled from the
+	// thread that created it)
+	SDL_Init(SDL_INIT_VIDEO);
+	SDL_Window* window = nullptr;
+	SDL_Renderer* sdl_renderer = nullptr;
+	SDL_CreateWindowAndRenderer(image_width, image_height, 0, &window, &sdl_renderer);
+
+	// same layout as the Renderer's image, so tiles can be uploaded as they are
+	SDL_Texture* texture = SDL_CreateTexture(
+		sdl_renderer,
+		SDL_PIXELFORMAT_RGB24,
+		SDL_TEXTUREACCESS_STREAMING,
+		image_width,
+		image_height
+	);
+	{
+		// streaming textures start out with undefined contents
+		std::vector<unsigned char> black(
+			image_width * image_height * Renderer::image_channels,
+			0
+		);
+		SDL_UpdateTexture(
+			texture,
+			nullptr,
+			black.data(),
+			image_width * Renderer::image_channels
+		);
+	}
+
+	Clock::duration frame_duration =
+		std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) /
+		this->refresh_rate;
+	Clock::time_point next_frame_time = Clock::now();
+	while (true) {
+		// checked before drawing, so tiles finished before close was called
+		// still get drawn
+		bool is_last_frame = this->stopping;
+
+		if (!this->pollEvents()) {
+			this->closed = true;
+			break;
+		}
+		this->drawTiles(sdl_renderer, texture);
+		if (is_last_frame) {
+			break;
+		}
+
+		// a frame which ran over doesn't make the next ones come sooner
+		next_frame_time = std::max(next_frame_time + frame_duration, Clock::now());
+		std::this_thread::sleep_until(next_frame_time);
+	}
+
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(sdl_renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+	// nothing will take the tiles finished from here on
+	this->renderer.detachPreview();
+}
+
+bool PreviewWindow::pollEvents()
+{
+	SDL_Event event;
+	while (SDL_PollEvent(&event)) {
+		if (event.type == SDL_QUIT) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void PreviewWindow::drawTiles(
+	SDL_Renderer* const& sdl_renderer,
+	SDL_Texture* const& texture
+) {
+	std::vector<Tile> tiles = this->renderer.takeCompletedTiles();
+	if (tiles.empty()) {
+		return;
+	}
+
+	PROFILE_SCOPE(preview_frame);
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	const Framebuffer& framebuffer = this->renderer.getFramebuffer();
+	for (const Tile& tile : tiles) {
+		// (tiles queued on attaching may not have been written yet)
+		if (!framebuffer.readTile(tile, this->tile_pixels.data())) {
+			continue;
+		}
+		SDL_Rect rect = {(int)tile.x, (int)tile.y, (int)tile.width, (int)tile.height};
+		SDL_UpdateTexture(
+			texture,
+			&rect,
+			this->tile_pixels.data(),
+			tile.width * Renderer::image_channels
+		);
+	}
+	SDL_RenderCopy(sdl_renderer, texture, nullptr, nullptr);
+	SDL_RenderPresent(sdl_renderer);
+
+	double frame_milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start_time
+	).count();
+	this->stats.frames++;
+	this->stats.total_frame_milliseconds += frame_milliseconds;
+	this->stats.max_frame_milliseconds =
+		std::max(this->stats.max_frame_milliseconds, frame_milliseconds);
+	this->stats.dropped_frames +=
+		(size_t)(frame_milliseconds * this->refresh_rate / 1000.0);
+}
@@ -0,0 +1,60 @@
+#ifndef RAYTRACER_PREVIEWWINDOW_HPP
+#define RAYTRACER_PREVIEWWINDOW_HPP
+
+#include <SDL2/SDL.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include "Renderer.hpp"
+
+struct PreviewStats {
+	unsigned int refresh_rate = 0;
+	// frames which had new tiles to show
+	size_t frames = 0;
+	// time spent uploading tiles and presenting, over all frames
+	double total_frame_milliseconds = 0.0;
+	double max_frame_milliseconds = 0.0;
+	// refresh intervals missed because a frame took longer than one interval
+	size_t dropped_frames = 0;
+};
+
+// Shows a render in progress in an SDL window, from a thread of its own, so
+// the thread driving the render (and the Renderer's workers) never wait on SDL.
+//
+// At most refresh_rate times a second, tiles finished since the last frame are
+// copied out of the Renderer's Framebuffer and uploaded with SDL_UpdateTexture,
+// and the texture is presented. Reading the Framebuffer never holds up workers.
+
+class PreviewWindow {
+private:
+	Renderer& renderer;
+	unsigned int refresh_rate;
+	std::thread thread;
+	std::atomic<bool> stopping;
+	std::atomic<bool> closed;
+	// only touched by thread, until it's joined
+	PreviewStats stats;
+	std::vector<unsigned char> tile_pixels;
+
+	void run();
+	// returns false if window was closed
+	bool pollEvents();
+	void drawTiles(SDL_Renderer* const& sdl_renderer, SDL_Texture* const& texture);
+public:
+	static const unsigned int default_refresh_rate = 30;
+	// renderer must have been started, since its Framebuffer is created then
+	PreviewWindow(Renderer& renderer, unsigned int refresh_rate = default_refresh_rate);
+	~PreviewWindow();
+	PreviewWindow(const PreviewWindow&) = delete;
+	PreviewWindow& operator=(const PreviewWindow&) = delete;
+	// true once the user has closed the window
+	bool isClosed() const;
+	// draws any tiles that are still to be shown, then closes the window
+	void close();
+	// complete once closed
+	PreviewStats getStats() const;
+};
+
+
+#endif //RAYTRACER_PREVIEWWINDOW_HPP
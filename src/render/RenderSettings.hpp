@@ -0,0 +1,35 @@
+#ifndef RAYTRACER_RENDERSETTINGS_HPP
+#define RAYTRACER_RENDERSETTINGS_HPP
+
+#include <cstdint>
+
+// What a render's pixels depend on, besides the scene and the image's size: how
+// rays are colored, and how each pixel is sampled (see Renderer::getRenderSettings).
+// Checkpoints and streamed images record them, so an interrupted render is only
+// ever finished the way it was started.
+
+struct RenderSettings {
+	// an Integrator
+	uint32_t integrator = 0;
+	// the AdaptiveSampling in use (all 0 if pixels aren't sampled adaptively), which
+	// also sets the samples per pixel when path tracing
+	uint32_t min_samples = 0;
+	uint32_t max_samples = 0;
+	float sample_threshold = 0.0f;
+
+	bool operator==(const RenderSettings& other) const
+	{
+		return this->integrator == other.integrator &&
+			this->min_samples == other.min_samples &&
+			this->max_samples == other.max_samples &&
+			this->sample_threshold == other.sample_threshold;
+	}
+
+	bool operator!=(const RenderSettings& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+
+#endif //RAYTRACER_RENDERSETTINGS_HPP
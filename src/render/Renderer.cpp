@@ -0,0 +1,913 @@
+#include <glm/glm.hpp>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <chrono>
+
+#include <src/entities/Camera.hpp>
+#include <src/entities/Light.hpp>
+#include <src/accel/BVH.hpp>
+#include <src/accel/SceneBVH.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/getColorForRay.hpp>
+#include <src/getPathColorForRay.hpp>
+#include <src/profiling/Profiler.hpp>
+
+#include "TileScheduler.hpp"
+#include "StreamedImage.hpp"
+#include "Checkpoint.hpp"
+#include "Framebuffer.hpp"
+#include "AdaptiveSampling.hpp"
+#include "CostMap.hpp"
+#include "SampleRandom.hpp"
+#include "Renderer.hpp"
+
+namespace {
+	// running totals of the work this thread has done, which pixels' costs are
+	// measured from
+	struct WorkDone {
+		std::chrono::steady_clock::time_point time;
+		unsigned long long intersection_tests;
+		unsigned long long shadow_rays;
+	};
+
+	WorkDone getWorkDone()
+	{
+		const BVHTraversalStats& traversal_stats = BVH::getTraversalStats();
+		WorkDone work;
+		work.time = std::chrono::steady_clock::now();
+		work.intersection_tests =
+			traversal_stats.nodes_visited + traversal_stats.primitive_tests;
+		work.shadow_rays = getThreadRayCounts().shadow_rays;
+		return work;
+	}
+
+	// work done between start and end, split evenly between pixel_count pixels
+	PixelCost getCost(
+		const WorkDone& start,
+		const WorkDone& end,
+		const unsigned int& pixel_count = 1
+	) {
+		PixelCost cost;
+		cost.nanoseconds = std::chrono::duration<float, std::nano>(
+			end.time - start.time
+		).count() / pixel_count;
+		cost.intersection_tests =
+			(float)(end.intersection_tests - start.intersection_tests) / pixel_count;
+		cost.shadow_rays = (float)(end.shadow_rays - start.shadow_rays) / pixel_count;
+		return cost;
+	}
+}
+
+Renderer::Renderer(
+	const Camera& camera,
+	const std::vector<Light>& lights,
+	const SceneBVH& scene,
+	size_t thread_count,
+	unsigned int tile_size
+) : camera(camera),
+    lights(lights),
+    scene(scene),
+    tile_size(tile_size),
+    streamed_image(nullptr),
+    cost_map(nullptr),
+    thread_count(thread_count ? thread_count : Renderer::getDefaultThreadCount()),
+    packet_kernels(&::getPacketKernels()),
+    integrator(Integrator::whitted),
+    progressive_sample_count(0),
+    pass_count(1),
+    pass(0),
+    workers_between_passes(0),
+    paused(false),
+    cancelled(false),
+    tiles_completed(0),
+    samples_traced(0),
+    pixels_sampled(0),
+    workers_running(0),
+    workers_parked(0),
+    is_preview_attached(false)
+{
+	this->image_width = this->camera.getPixelWidth();
+	this->image_height = this->camera.getPixelHeight();
+	this->tiles = TileScheduler::makeTiles(this->image_width, this->image_height, tile_size);
+	this->scheduler.reset(new TileScheduler(this->tiles, this->thread_count));
+}
+
+Renderer::~Renderer()
+{
+	this->stop();
+	this->wait();
+}
+
+void Renderer::setPacketKernels(const PacketKernels* const& kernels)
+{
+	this->packet_kernels = kernels;
+}
+
+const PacketKernels* Renderer::getPacketKernels() const
+{
+	return this->packet_kernels;
+}
+
+void Renderer::setAdaptiveSampling(const AdaptiveSampling& sampling)
+{
+	this->sampling.reset(new AdaptiveSampling(sampling));
+}
+
+const AdaptiveSampling* Renderer::getAdaptiveSampling() const
+{
+	return this->sampling.get();
+}
+
+void Renderer::setIntegrator(const Integrator& integrator)
+{
+	this->integrator = integrator;
+}
+
+Integrator Renderer::getIntegrator() const
+{
+	return this->integrator;
+}
+
+RenderSettings Renderer::getRenderSettings() const
+{
+	RenderSettings settings;
+	settings.integrator = (uint32_t)this->integrator;
+	if (this->sampling) {
+		settings.min_samples = this->sampling->min_samples;
+		settings.max_samples = this->sampling->max_samples;
+		settings.sample_threshold = this->sampling->threshold;
+	}
+	return settings;
+}
+
+void Renderer::setProgressiveSampleCount(const unsigned int& sample_count)
+{
+	this->progressive_sample_count = sample_count;
+	// one more for the preview
+	this->pass_count = sample_count + 1;
+}
+
+unsigned int Renderer::getProgressiveSampleCount() const
+{
+	return this->progressive_sample_count;
+}
+
+size_t Renderer::getPass() const
+{
+	return this->pass;
+}
+
+size_t Renderer::getPassCount() const
+{
+	return this->pass_count;
+}
+
+std::vector<double> Renderer::getPassMilliseconds()
+{
+	std::lock_guard<std::mutex> lock(this->pause_mut);
+	return this->pass_milliseconds;
+}
+
+void Renderer::setStreamedImage(StreamedImage* const& streamed_image)
+{
+	this->streamed_image = streamed_image;
+	std::vector<bool> completed_tiles;
+	for (const Tile& tile : this->tiles) {
+		completed_tiles.push_back(streamed_image->isTileComplete(tile));
+	}
+	this->skipCompletedTiles(completed_tiles);
+}
+
+void Renderer::setCostMap(CostMap* const& cost_map)
+{
+	this->cost_map = cost_map;
+}
+
+Checkpoint Renderer::getCheckpoint()
+{
+	Checkpoint checkpoint;
+	checkpoint.image_width = this->image_width;
+	checkpoint.image_height = this->image_height;
+	checkpoint.tile_size = this->tile_size;
+	checkpoint.settings = this->getRenderSettings();
+	checkpoint.image = this->framebuffer->copyImage(&checkpoint.completed_tiles);
+	if (this->progressive_sample_count) {
+		checkpoint.color_sums =
+			this->framebuffer->copyColorSums(&checkpoint.tile_sample_counts);
+		for (size_t i = 0, len = this->tiles.size(); i < len; i++) {
+			checkpoint.completed_tiles[i] =
+				checkpoint.tile_sample_counts[i] >= this->progressive_sample_count;
+		}
+	}
+	return checkpoint;
+}
+
+void Renderer::restoreCheckpoint(const Checkpoint& checkpoint)
+{
+	if (
+		checkpoint.image_width != this->image_width ||
+		checkpoint.image_height != this->image_height ||
+		checkpoint.tile_size != this->tile_size ||
+		checkpoint.completed_tiles.size() != this->tiles.size()
+	) {
+		throw std::runtime_error("Checkpoint is of a different sized render.");
+	}
+	if (checkpoint.settings != this->getRenderSettings()) {
+		throw std::runtime_error(
+			"Checkpoint is of a render with a different integrator or sampling."
+		);
+	}
+	bool is_progressive = this->progressive_sample_count != 0;
+	if (checkpoint.tile_sample_counts.empty() == is_progressive) {
+		throw std::runtime_error(
+			is_progressive ?
+				"Checkpoint is of a render that isn't progressive." :
+				"Checkpoint is of a progressive render."
+		);
+	}
+	if (is_progressive && checkpoint.tile_sample_counts.size() != this->tiles.size()) {
+		throw std::runtime_error("Checkpoint is of a different sized render.");
+	}
+
+	this->framebuffer.reset(new Framebuffer(
+		this->image_width,
+		this->image_height,
+		this->tile_size,
+		is_progressive
+	));
+	if (is_progressive) {
+		// passes still needed are worked out from these by start
+		std::vector<float> tile_color_sums;
+		size_t tiles_completed = 0;
+		for (size_t i = 0, len = this->tiles.size(); i < len; i++) {
+			if (checkpoint.tile_sample_counts[i] == 0) {
+				continue;
+			}
+			// (a tile with samples has had its preview too)
+			tiles_completed +=
+				std::min((size_t)checkpoint.tile_sample_counts[i] + 1, this->pass_count);
+			const Tile& tile = this->tiles[i];
+			tile_color_sums.clear();
+			for (unsigned int y = tile.y; y < tile.y + tile.height; y++) {
+				auto row = checkpoint.color_sums.begin() +
+					((size_t)y * this->image_width + tile.x) * image_channels;
+				tile_color_sums.insert(
+					tile_color_sums.end(),
+					row,
+					row + tile.width * image_channels
+				);
+			}
+			this->framebuffer->restoreTile(
+				tile,
+				tile_color_sums.data(),
+				checkpoint.tile_sample_counts[i]
+			);
+		}
+		this->tiles_completed = tiles_completed;
+		return;
+	}
+	std::vector<unsigned char> tile_pixels;
+	for (size_t i = 0, len = this->tiles.size(); i < len; i++) {
+		if (!checkpoint.completed_tiles[i]) {
+			continue;
+		}
+		const Tile& tile = this->tiles[i];
+		tile_pixels.clear();
+		for (unsigned int y = tile.y; y < tile.y + tile.height; y++) {
+			auto row = checkpoint.image.begin() +
+				((size_t)y * this->image_width + tile.x) * image_channels;
+			tile_pixels.insert(tile_pixels.end(), row, row + tile.width * image_channels);
+		}
+		this->framebuffer->writeTile(tile, tile_pixels.data());
+	}
+	this->skipCompletedTiles(checkpoint.completed_tiles);
+}
+
+void Renderer::skipCompletedTiles(const std::vector<bool>& completed_tiles)
+{
+	std::vector<Tile> remaining_tiles;
+	for (size_t i = 0, len = this->tiles.size(); i < len; i++) {
+		if (!completed_tiles[i]) {
+			remaining_tiles.push_back(this->tiles[i]);
+		}
+	}
+	this->tiles_completed = this->tiles.size() - remaining_tiles.size();
+	this->scheduler.reset(new TileScheduler(remaining_tiles, this->thread_count));
+}
+
+void Renderer::start()
+{
+	// (a restored checkpoint has created the framebuffer already)
+	if (!this->streamed_image && !this->framebuffer) {
+		this->framebuffer.reset(new Framebuffer(
+			this->image_width,
+			this->image_height,
+			this->tile_size,
+			this->progressive_sample_count != 0
+		));
+	}
+	this->start_time = std::chrono::steady_clock::now();
+	if (this->progressive_sample_count) {
+		std::lock_guard<std::mutex> lock(this->pause_mut);
+		this->schedulePass(0);
+	}
+	this->workers_running = this->thread_count;
+	for (size_t i = 0; i < this->thread_count; i++) {
+		this->workers.emplace_back(&Renderer::runWorker, this, i);
+	}
+}
+
+void Renderer::pause()
+{
+	std::unique_lock<std::mutex> lock(this->pause_mut);
+	this->paused = true;
+	this->pause_cv.wait(lock, [this]() {
+		return this->workers_parked == this->workers_running;
+	});
+}
+
+void Renderer::resume()
+{
+	std::lock_guard<std::mutex> lock(this->pause_mut);
+	this->paused = false;
+	this->pause_cv.notify_all();
+}
+
+void Renderer::stop()
+{
+	std::lock_guard<std::mutex> lock(this->pause_mut);
+	this->cancelled = true;
+	this->paused = false;
+	this->pause_cv.notify_all();
+}
+
+void Renderer::wait()
+{
+	for (std::thread& worker : this->workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+}
+
+bool Renderer::isDone() const
+{
+	return this->workers_running == 0;
+}
+
+size_t Renderer::getThreadCount() const
+{
+	return this->thread_count;
+}
+
+unsigned int Renderer::getTileSize() const
+{
+	return this->tile_size;
+}
+
+size_t Renderer::getTileCount() const
+{
+	return this->tiles.size() * this->pass_count;
+}
+
+size_t Renderer::getCompletedTileCount() const
+{
+	return this->tiles_completed;
+}
+
+void Renderer::attachPreview()
+{
+	std::lock_guard<std::mutex> lock(this->completed_mut);
+	this->completed_tiles = this->tiles;
+	this->is_preview_attached = true;
+}
+
+void Renderer::detachPreview()
+{
+	std::lock_guard<std::mutex> lock(this->completed_mut);
+	this->is_preview_attached = false;
+	std::vector<Tile>().swap(this->completed_tiles);
+}
+
+std::vector<Tile> Renderer::takeCompletedTiles()
+{
+	std::vector<Tile> taken;
+	std::lock_guard<std::mutex> lock(this->completed_mut);
+	taken.swap(this->completed_tiles);
+	return taken;
+}
+
+unsigned int Renderer::getImageWidth() const
+{
+	return this->image_width;
+}
+
+unsigned int Renderer::getImageHeight() const
+{
+	return this->image_height;
+}
+
+const Framebuffer& Renderer::getFramebuffer() const
+{
+	return *this->framebuffer;
+}
+
+BVHTraversalStats Renderer::getTraversalStats()
+{
+	std::lock_guard<std::mutex> lock(this->stats_mut);
+	return this->traversal_stats;
+}
+
+RayCounts Renderer::getRayCounts()
+{
+	std::lock_guard<std::mutex> lock(this->stats_mut);
+	return this->ray_counts;
+}
+
+double Renderer::getAverageSampleCount() const
+{
+	uint64_t pixels_sampled = this->pixels_sampled;
+	return pixels_sampled ? (double)this->samples_traced / pixels_sampled : 0.0;
+}
+
+size_t Renderer::getDefaultThreadCount()
+{
+	// hardware_concurrency is allowed to return 0 if it can't tell
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void Renderer::runWorker(size_t worker_index)
+{
+	// each tile is rendered here, then published
+	std::vector<glm::vec3> tile_colors(this->tile_size * this->tile_size);
+	std::vector<unsigned char> tile_pixels(
+		this->tile_size * this->tile_size * image_channels
+	);
+
+	size_t pass = 0;
+	while (true) {
+		bool is_preview = this->progressive_sample_count && pass == 0;
+		// (pass 0 of a progressive render is the preview, and its later passes each
+		// add a sample)
+		unsigned int sample_index = pass > 0 ? pass - 1 : 0;
+		Tile tile;
+		while (this->waitWhilePaused() && this->scheduler->takeTile(worker_index, &tile)) {
+			PROFILE_SCOPE(render_tile);
+			bool is_rendered = is_preview ?
+				this->renderPreviewTile(tile, tile_colors.data()) :
+				this->renderTile(tile, sample_index, tile_colors.data());
+			if (!is_rendered) {
+				break;
+			}
+			if (this->progressive_sample_count && !is_preview) {
+				this->framebuffer->accumulateTile(tile, tile_colors.data());
+			} else {
+				for (size_t i = 0, len = tile.width * tile.height; i < len; i++) {
+					this->setPixel(&tile_pixels[i * image_channels], tile_colors[i]);
+				}
+				if (this->streamed_image) {
+					this->streamed_image->writeTile(tile, tile_pixels.data());
+				} else {
+					this->framebuffer->writeTile(tile, tile_pixels.data());
+				}
+			}
+			this->tiles_completed++;
+			if (this->is_preview_attached) {
+				std::lock_guard<std::mutex> lock(this->completed_mut);
+				// (checked again, in case the preview detached meanwhile)
+				if (this->is_preview_attached) {
+					this->completed_tiles.push_back(tile);
+				}
+			}
+		}
+		pass++;
+		if (this->cancelled || pass == this->pass_count || !this->waitForPass(pass)) {
+			break;
+		}
+	}
+
+	{
+		const BVHTraversalStats& worker_stats = BVH::getTraversalStats();
+		std::lock_guard<std::mutex> lock(this->stats_mut);
+		this->traversal_stats.rays += worker_stats.rays;
+		this->traversal_stats.nodes_visited += worker_stats.nodes_visited;
+		this->traversal_stats.primitive_tests += worker_stats.primitive_tests;
+		const RayCounts& worker_ray_counts = getThreadRayCounts();
+		this->ray_counts.primary_rays += worker_ray_counts.primary_rays;
+		this->ray_counts.shadow_rays += worker_ray_counts.shadow_rays;
+		this->ray_counts.secondary_rays += worker_ray_counts.secondary_rays;
+	}
+
+	std::lock_guard<std::mutex> lock(this->pause_mut);
+	this->workers_running--;
+	if (this->workers_running == 0 && !this->cancelled) {
+		// the end of the last pass
+		this->pass_milliseconds.push_back(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - this->start_time
+		).count());
+	}
+	// a pause() call might be waiting on this worker
+	this->pause_cv.notify_all();
+}
+
+void Renderer::schedulePass(const size_t& pass)
+{
+	std::vector<Tile> remaining_tiles;
+	for (const Tile& tile : this->tiles) {
+		uint32_t sample_count = this->framebuffer->getTileSampleCount(tile);
+		// tiles with samples already need no preview
+		if (pass == 0 ? sample_count == 0 : sample_count < pass) {
+			remaining_tiles.push_back(tile);
+		}
+	}
+	this->scheduler.reset(new TileScheduler(remaining_tiles, this->thread_count));
+	this->pass = pass;
+}
+
+bool Renderer::waitForPass(const size_t& next_pass)
+{
+	std::unique_lock<std::mutex> lock(this->pause_mut);
+	// waiting here counts as parked, so pause() doesn't wait for the pass to end
+	this->workers_parked++;
+	this->workers_between_passes++;
+	if (this->workers_between_passes == this->workers_running) {
+		// the last one to finish starts the next pass
+		this->workers_between_passes = 0;
+		this->pass_milliseconds.push_back(std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - this->start_time
+		).count());
+		this->schedulePass(next_pass);
+	}
+	this->pause_cv.notify_all();
+	this->pause_cv.wait(lock, [&]() {
+		return this->pass >= next_pass || this->cancelled;
+	});
+	this->workers_parked--;
+	return !this->cancelled;
+}
+
+glm::vec3 Renderer::getPrimaryRay(
+	const unsigned int& x,
+	const unsigned int& y,
+	const unsigned int& sample_index
+) const
+{
+	if (sample_index == 0) {
+		return this->camera.getRayDirection(x + 0.5f, y + 0.5f);
+	}
+	glm::vec2 offset = AdaptiveSampling::getSampleOffset(x, y, sample_index - 1);
+	return this->camera.getRayDirection(x + offset.x, y + offset.y);
+}
+
+glm::vec3 Renderer::traceRay(
+	const glm::vec3& direction,
+	const unsigned int& x,
+	const unsigned int& y,
+	const unsigned int& sample_index
+) {
+	if (this->integrator == Integrator::path) {
+		SampleRandom random(x, y, sample_index);
+		return getPathColorForRay(
+			this->camera.getPosition(),
+			direction,
+			this->lights,
+			this->scene,
+			this->packet_kernels,
+			&random
+		);
+	}
+	return getColorForRay(
+		this->camera.getPosition(),
+		direction,
+		this->lights,
+		this->scene,
+		this->packet_kernels
+	);
+}
+
+glm::vec3 Renderer::shadeRay(
+	const glm::vec3& direction,
+	const float& t,
+	const glm::vec3& normal,
+	const Object3D* const& object,
+	const unsigned int& x,
+	const unsigned int& y,
+	const unsigned int& sample_index
+) {
+	if (!object) {
+		return glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+	if (this->integrator == Integrator::path) {
+		SampleRandom random(x, y, sample_index);
+		return getPathColorForIntersection(
+			this->camera.getPosition(),
+			direction,
+			t,
+			normal,
+			object,
+			this->lights,
+			this->scene,
+			this->packet_kernels,
+			&random
+		);
+	}
+	return getColorForIntersection(
+		this->camera.getPosition(),
+		direction,
+		t,
+		normal,
+		object,
+		this->lights,
+		this->scene,
+		this->packet_kernels
+	);
+}
+
+bool Renderer::renderTile(
+	const Tile& tile,
+	const unsigned int& sample_index,
+	glm::vec3* const& colors
+) {
+	unsigned int x_end = tile.x + tile.width;
+	unsigned int y_end = tile.y + tile.height;
+	unsigned int rows_per_step =
+		this->packet_kernels && !this->sampling ? packet_height : 1;
+
+	for (unsigned int y = tile.y; y < y_end; y += rows_per_step) {
+		if (!this->waitWhilePaused()) {
+			return false;
+		}
+		glm::vec3* row_colors = colors + (y - tile.y) * tile.width;
+		if (this->sampling) {
+			uint64_t sample_count = 0;
+			for (unsigned int x = tile.x; x < x_end; x++) {
+				if (!this->cost_map) {
+					row_colors[x - tile.x] = this->samplePixel(x, y, &sample_count);
+					continue;
+				}
+				WorkDone start = getWorkDone();
+				row_colors[x - tile.x] = this->samplePixel(x, y, &sample_count);
+				this->cost_map->addCost(x, y, getCost(start, getWorkDone()));
+			}
+			this->samples_traced += sample_count;
+			this->pixels_sampled += tile.width;
+			getThreadRayCounts().primary_rays += sample_count;
+			continue;
+		}
+		if (this->packet_kernels) {
+			for (unsigned int x = tile.x; x < x_end; x += packet_width) {
+				this->renderPacket(
+					x,
+					y,
+					std::min(x + packet_width, x_end),
+					std::min(y + packet_height, y_end),
+					sample_index,
+					row_colors + (x - tile.x),
+					tile.width
+				);
+			}
+			continue;
+		}
+		getThreadRayCounts().primary_rays += tile.width;
+		for (unsigned int x = tile.x; x < x_end; x++) {
+			WorkDone start;
+			if (this->cost_map) {
+				start = getWorkDone();
+			}
+			row_colors[x - tile.x] =
+				this->traceRay(this->getPrimaryRay(x, y, sample_index), x, y, sample_index);
+			if (this->cost_map) {
+				this->cost_map->addCost(x, y, getCost(start, getWorkDone()));
+			}
+		}
+	}
+	return true;
+}
+
+bool Renderer::renderPreviewTile(const Tile& tile, glm::vec3* const& colors)
+{
+	unsigned int x_end = tile.x + tile.width;
+	unsigned int y_end = tile.y + tile.height;
+
+	for (unsigned int y = tile.y; y < y_end; y += preview_block_size) {
+		if (!this->waitWhilePaused()) {
+			return false;
+		}
+		unsigned int block_y_end = std::min(y + preview_block_size, y_end);
+		for (unsigned int x = tile.x; x < x_end; x += preview_block_size) {
+			unsigned int block_x_end = std::min(x + preview_block_size, x_end);
+			getThreadRayCounts().primary_rays++;
+			glm::vec3 color = this->traceRay(this->getPrimaryRay(x, y, 0), x, y, 0);
+			for (unsigned int block_y = y; block_y < block_y_end; block_y++) {
+				glm::vec3* row_colors = colors + (block_y - tile.y) * tile.width;
+				std::fill(
+					row_colors + (x - tile.x),
+					row_colors + (block_x_end - tile.x),
+					color
+				);
+			}
+		}
+	}
+	return true;
+}
+
+void Renderer::renderPacket(
+	const unsigned int& x_begin,
+	const unsigned int& y_begin,
+	const unsigned int& x_end,
+	const unsigned int& y_end,
+	const unsigned int& sample_index,
+	glm::vec3* const& colors,
+	const size_t& row_stride
+) {
+	static_assert(
+		packet_width * packet_height == RayPacket::size,
+		"Packet must cover a rectangle of pixels."
+	);
+
+	glm::vec3 center_of_projection = this->camera.getPosition();
+
+	RayPacket packet;
+	glm::vec3 directions[RayPacket::size];
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		unsigned int x = x_begin + lane % packet_width;
+		unsigned int y = y_begin + lane / packet_width;
+		// lanes falling outside the tile (at its right or bottom edge) repeat
+		// a pixel inside it, but are left inactive
+		directions[lane] = this->getPrimaryRay(
+			std::min(x, x_end - 1),
+			std::min(y, y_end - 1),
+			sample_index
+		);
+		bool is_inside_tile = x < x_end && y < y_end;
+		packet.setRay(lane, center_of_projection, directions[lane], is_inside_tile);
+	}
+
+	unsigned int pixel_count = (x_end - x_begin) * (y_end - y_begin);
+	WorkDone work_done;
+	if (this->cost_map) {
+		work_done = getWorkDone();
+	}
+	{
+		PROFILE_SCOPE(intersect);
+		this->scene.intersectPacket(&packet, *this->packet_kernels);
+	}
+	getThreadRayCounts().primary_rays += pixel_count;
+	// the packet's pixels share the cost of intersecting it, then each adds the
+	// cost of its own shading
+	PixelCost intersection_cost;
+	if (this->cost_map) {
+		WorkDone intersected = getWorkDone();
+		intersection_cost = getCost(work_done, intersected, pixel_count);
+		work_done = intersected;
+	}
+
+	for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+		if (!(packet.lane_mask & (1u << lane))) {
+			continue;
+		}
+		unsigned int x = x_begin + lane % packet_width;
+		unsigned int y = y_begin + lane / packet_width;
+		colors[(lane / packet_width) * row_stride + lane % packet_width] = this->shadeRay(
+			directions[lane],
+			packet.t[lane],
+			packet.normals[lane],
+			packet.objects[lane],
+			x,
+			y,
+			sample_index
+		);
+		if (this->cost_map) {
+			WorkDone shaded = getWorkDone();
+			this->cost_map->addCost(x, y, intersection_cost);
+			this->cost_map->addCost(x, y, getCost(work_done, shaded));
+			work_done = shaded;
+		}
+	}
+}
+
+glm::vec3 Renderer::samplePixel(
+	const unsigned int& x,
+	const unsigned int& y,
+	uint64_t* const& sample_count
+) {
+	const AdaptiveSampling& sampling = *this->sampling;
+	glm::vec3 color_sum(0.0f, 0.0f, 0.0f);
+	glm::vec3 squared_color_sum(0.0f, 0.0f, 0.0f);
+	float squared_threshold = sampling.threshold * sampling.threshold;
+
+	unsigned int samples = 0;
+	unsigned int batch_size = sampling.min_samples;
+	while (true) {
+		unsigned int sample_end = std::min(samples + batch_size, sampling.max_samples);
+		this->traceSamples(x, y, samples, sample_end, &color_sum, &squared_color_sum);
+		samples = sample_end;
+		if (samples >= sampling.max_samples) {
+			break;
+		}
+		// unbiased variance of the samples, divided by their number for the
+		// (squared) standard error of their mean
+		glm::vec3 mean = color_sum / (float)samples;
+		glm::vec3 squared_error =
+			(squared_color_sum - mean * color_sum) / ((float)samples * (samples - 1));
+		if (
+			squared_error.r <= squared_threshold &&
+			squared_error.g <= squared_threshold &&
+			squared_error.b <= squared_threshold
+		) {
+			break;
+		}
+		batch_size = RayPacket::size;
+	}
+	*sample_count += samples;
+	return color_sum / (float)samples;
+}
+
+void Renderer::traceSamples(
+	const unsigned int& x,
+	const unsigned int& y,
+	const unsigned int& sample_begin,
+	const unsigned int& sample_end,
+	glm::vec3* const& color_sum,
+	glm::vec3* const& squared_color_sum
+) {
+	glm::vec3 center_of_projection = this->camera.getPosition();
+	glm::vec3 directions[RayPacket::size];
+
+	for (unsigned int begin = sample_begin; begin < sample_end; begin += RayPacket::size) {
+		unsigned int count = std::min(sample_end - begin, RayPacket::size);
+		for (unsigned int i = 0; i < count; i++) {
+			glm::vec2 offset = AdaptiveSampling::getSampleOffset(x, y, begin + i);
+			directions[i] = this->camera.getRayDirection(x + offset.x, y + offset.y);
+		}
+
+		glm::vec3 colors[RayPacket::size];
+		if (this->packet_kernels) {
+			RayPacket packet;
+			for (unsigned int lane = 0; lane < RayPacket::size; lane++) {
+				// lanes past the last sample repeat the first, but are left inactive
+				bool is_sample = lane < count;
+				packet.setRay(
+					lane,
+					center_of_projection,
+					directions[is_sample ? lane : 0],
+					is_sample
+				);
+			}
+			{
+				PROFILE_SCOPE(intersect);
+				this->scene.intersectPacket(&packet, *this->packet_kernels);
+			}
+			for (unsigned int lane = 0; lane < count; lane++) {
+				colors[lane] = this->shadeRay(
+					directions[lane],
+					packet.t[lane],
+					packet.normals[lane],
+					packet.objects[lane],
+					x,
+					y,
+					begin + lane
+				);
+			}
+		} else {
+			for (unsigned int i = 0; i < count; i++) {
+				colors[i] = this->traceRay(directions[i], x, y, begin + i);
+			}
+		}
+
+		for (unsigned int i = 0; i < count; i++) {
+			*color_sum += colors[i];
+			*squared_color_sum += colors[i] * colors[i];
+		}
+	}
+}
+
+void Renderer::setPixel(unsigned char* const& pixel, const glm::vec3& color)
+{
+	pixel[0] = (unsigned char)round(255.0 * color.r);
+	pixel[1] = (unsigned char)round(255.0 * color.g);
+	pixel[2] = (unsigned char)round(255.0 * color.b);
+}
+
+bool Renderer::waitWhilePaused()
+{
+	if (!this->paused) {
+		return !this->cancelled;
+	}
+	std::unique_lock<std::mutex> lock(this->pause_mut);
+	this->workers_parked++;
+	this->pause_cv.notify_all();
+	this->pause_cv.wait(lock, [this]() {
+		return !this->paused || this->cancelled;
+	});
+	this->workers_parked--;
+	return !this->cancelled;
+}
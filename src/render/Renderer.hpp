@@ -0,0 +1,302 @@
+#ifndef RAYTRACER_RENDERER_HPP
+#define RAYTRACER_RENDERER_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+#include <src/entities/Camera.hpp>
+#include <src/entities/Light.hpp>
+#include <src/accel/BVH.hpp>
+#include <src/accel/SceneBVH.hpp>
+#include <src/accel/RayPacket.hpp>
+#include <src/accel/packetKernels.hpp>
+#include <src/getColorForRay.hpp>
+
+#include "TileScheduler.hpp"
+#include "StreamedImage.hpp"
+#include "Checkpoint.hpp"
+#include "RenderSettings.hpp"
+#include "Framebuffer.hpp"
+#include "AdaptiveSampling.hpp"
+#include "CostMap.hpp"
+
+// how rays are colored: with Whitted-style Phong shading, reflection and
+// refraction (getColorForRay), or by path tracing (getPathColorForRay)
+enum class Integrator {
+	whitted,
+	path
+};
+
+// Renders the scene into an RGB image on a pool of worker threads. The image is
+// split into tiles which are handed out by a work-stealing TileScheduler. Each
+// worker renders the tile it took into a buffer of its own, then publishes it
+// whole to a Framebuffer, which can be read at any time without holding up the
+// workers.
+//
+// Alternatively, finished tiles can be handed to a StreamedImage, which writes them
+// to disk, so no more than a tile per worker is held in memory at once.
+//
+// Primary rays are traced in packets of neighbouring pixels (see RayPacket), unless
+// packet tracing is switched off, in which case they're traced one at a time.
+// With adaptive sampling, each pixel is instead sampled at several points over
+// its area (see AdaptiveSampling), and a pixel's samples make up its packets.
+//
+// Progressive renders go over the image in several passes, each one tile by tile:
+// first a coarse one, tracing one ray for each block of preview_block_size x
+// preview_block_size pixels, then one adding a sample at each pixel's center, then
+// one more for each further sample, placed as by AdaptiveSampling. Samples are
+// accumulated in the Framebuffer, and each pass only starts once the last one
+// has finished.
+//
+// When path tracing, each sample of a pixel is given its own random numbers (see
+// SampleRandom), keyed by the pixel and the sample's index, so renders come out the
+// same whatever the number of threads or the order tiles are rendered in.
+//
+// Pausing, resuming and stopping are signalled through atomic flags which
+// workers check between rows of a tile; a paused worker sleeps until resumed.
+
+class Renderer {
+private:
+	const Camera& camera;
+	const std::vector<Light>& lights;
+	const SceneBVH& scene;
+	unsigned int image_width;
+	unsigned int image_height;
+	unsigned int tile_size;
+	// created by start (or restoreCheckpoint), unless streaming
+	std::unique_ptr<Framebuffer> framebuffer;
+	// nullptr to keep the image in memory
+	StreamedImage* streamed_image;
+	// nullptr unless recording what each pixel cost
+	CostMap* cost_map;
+	size_t thread_count;
+	// nullptr to trace one ray at a time
+	const PacketKernels* packet_kernels;
+	// nullptr to trace a single ray through each pixel's center
+	std::unique_ptr<AdaptiveSampling> sampling;
+	Integrator integrator;
+	// samples per pixel of a progressive render, 0 if not progressive
+	unsigned int progressive_sample_count;
+	// 1 unless progressive
+	size_t pass_count;
+	// only modified while holding pause_mut
+	std::atomic<size_t> pass;
+	// workers which have finished pass and are waiting for the next one
+	size_t workers_between_passes;
+	// since start, to the end of each pass done so far. Only accessed while
+	// holding pause_mut.
+	std::chrono::steady_clock::time_point start_time;
+	std::vector<double> pass_milliseconds;
+	std::vector<Tile> tiles;
+	std::unique_ptr<TileScheduler> scheduler;
+	std::vector<std::thread> workers;
+
+	std::atomic<bool> paused;
+	std::atomic<bool> cancelled;
+	// counting each pass over a tile separately
+	std::atomic<size_t> tiles_completed;
+	// primary rays traced for pixels rendered with adaptive sampling
+	std::atomic<uint64_t> samples_traced;
+	std::atomic<uint64_t> pixels_sampled;
+	// these two are only modified while holding pause_mut
+	std::atomic<size_t> workers_running;
+	size_t workers_parked;
+	std::mutex pause_mut;
+	std::condition_variable pause_cv;
+
+	// tiles finished since last call to takeCompletedTiles, only kept while a
+	// preview is attached
+	std::atomic<bool> is_preview_attached;
+	std::mutex completed_mut;
+	std::vector<Tile> completed_tiles;
+
+	// merged from each worker's thread-local counters as it exits
+	std::mutex stats_mut;
+	BVHTraversalStats traversal_stats;
+	RayCounts ray_counts;
+
+	void runWorker(size_t worker_index);
+	// leaves tiles out of the render if flagged in completed_tiles (one per tile)
+	void skipCompletedTiles(const std::vector<bool>& completed_tiles);
+	// hands out the tiles of a progressive render which still need pass. Called
+	// while holding pause_mut.
+	void schedulePass(const size_t& pass);
+	// blocks until every worker has finished the pass before next_pass, then
+	// returns true, or returns false if the render was stopped
+	bool waitForPass(const size_t& next_pass);
+	// direction of primary ray for sample number sample_index of pixel (x, y),
+	// sample 0 being through its center
+	glm::vec3 getPrimaryRay(
+		const unsigned int& x,
+		const unsigned int& y,
+		const unsigned int& sample_index
+	) const;
+	// color of a ray from the camera, traced as sample number sample_index of pixel
+	// (x, y) (which picks the path tracer's random numbers)
+	glm::vec3 traceRay(
+		const glm::vec3& direction,
+		const unsigned int& x,
+		const unsigned int& y,
+		const unsigned int& sample_index
+	);
+	// the same, for a ray whose closest hit has been found already (object being
+	// nullptr if it hit nothing)
+	glm::vec3 shadeRay(
+		const glm::vec3& direction,
+		const float& t,
+		const glm::vec3& normal,
+		const Object3D* const& object,
+		const unsigned int& x,
+		const unsigned int& y,
+		const unsigned int& sample_index
+	);
+	// writes a color for each of the tile's pixels to colors, tightly packed,
+	// taking sample number sample_index of each (or sampling adaptively). Returns
+	// false if tile was abandoned because the render was stopped.
+	bool renderTile(
+		const Tile& tile,
+		const unsigned int& sample_index,
+		glm::vec3* const& colors
+	);
+	// traces sample sample_index of pixels [x_begin, x_end) x [y_begin, y_end) as
+	// a single packet, where colors points at the first of them
+	void renderPacket(
+		const unsigned int& x_begin,
+		const unsigned int& y_begin,
+		const unsigned int& x_end,
+		const unsigned int& y_end,
+		const unsigned int& sample_index,
+		glm::vec3* const& colors,
+		const size_t& row_stride
+	);
+	// fills each preview block of the tile with the color of a ray through its top
+	// left pixel
+	bool renderPreviewTile(const Tile& tile, glm::vec3* const& colors);
+	// mean color of the adaptively placed samples of pixel (x, y). Adds the
+	// number taken to *sample_count.
+	glm::vec3 samplePixel(
+		const unsigned int& x,
+		const unsigned int& y,
+		uint64_t* const& sample_count
+	);
+	// traces samples [sample_begin, sample_end) of pixel (x, y), adding their
+	// colors (and those squared) to the sums
+	void traceSamples(
+		const unsigned int& x,
+		const unsigned int& y,
+		const unsigned int& sample_begin,
+		const unsigned int& sample_end,
+		glm::vec3* const& color_sum,
+		glm::vec3* const& squared_color_sum
+	);
+	void setPixel(unsigned char* const& pixel, const glm::vec3& color);
+	// returns false if render was stopped
+	bool waitWhilePaused();
+public:
+	static const unsigned int default_tile_size = 32;
+	static const int image_channels = 3;
+	// pixels covered by each packet of primary rays
+	static const unsigned int packet_width = 4;
+	static const unsigned int packet_height = RayPacket::size / packet_width;
+	// pixels covered by each ray of a progressive render's first pass, across and
+	// down (so it traces 1/16 as many)
+	static const unsigned int preview_block_size = 4;
+	// thread_count of 0 means one thread per hardware thread
+	Renderer(
+		const Camera& camera,
+		const std::vector<Light>& lights,
+		const SceneBVH& scene,
+		size_t thread_count = 0,
+		unsigned int tile_size = default_tile_size
+	);
+	~Renderer();
+	Renderer(const Renderer&) = delete;
+	Renderer& operator=(const Renderer&) = delete;
+	// defaults to the widest kernels the CPU supports. Must be called before start.
+	void setPacketKernels(const PacketKernels* const& kernels);
+	const PacketKernels* getPacketKernels() const;
+	// anti-aliases the render, sampling each pixel as set out in sampling. Must be
+	// called before start.
+	void setAdaptiveSampling(const AdaptiveSampling& sampling);
+	// nullptr if not sampling adaptively
+	const AdaptiveSampling* getAdaptiveSampling() const;
+	// defaults to Integrator::whitted. Must be called before start.
+	void setIntegrator(const Integrator& integrator);
+	Integrator getIntegrator() const;
+	// the integrator and sampling set so far, as recorded by checkpoints and
+	// streamed images
+	RenderSettings getRenderSettings() const;
+	// renders progressively, in passes adding up to sample_count samples per pixel.
+	// Can't be combined with adaptive sampling or streaming. Must be called before
+	// start (and restoreCheckpoint).
+	void setProgressiveSampleCount(const unsigned int& sample_count);
+	// 0 if not progressive
+	unsigned int getProgressiveSampleCount() const;
+	// the one being rendered (or the last, once done)
+	size_t getPass() const;
+	size_t getPassCount() const;
+	// time from start to the end of each pass finished so far
+	std::vector<double> getPassMilliseconds();
+	// writes finished tiles to streamed_image instead of keeping the image in
+	// memory, skipping tiles it already has. Must be called before start.
+	void setStreamedImage(StreamedImage* const& streamed_image);
+	// records what each pixel rendered costs in cost_map, which must be the size
+	// of the image. Measuring costs slows the render a little. Must be called
+	// before start.
+	void setCostMap(CostMap* const& cost_map);
+	// snapshot of the tiles finished so far. Safe to call while rendering, but
+	// not when streaming (the StreamedImage keeps its own record of finished tiles).
+	// Tiles only reach the checkpoint once finished, except in progressive renders,
+	// where each tile's accumulated samples are saved.
+	Checkpoint getCheckpoint();
+	// carries on from checkpoint, only rendering the tiles (or samples) it's
+	// missing. Must be called before start (after the integrator and sampling are
+	// set). Throws std::runtime_error if checkpoint is of a different sized image or
+	// has different render settings, or only one of it and this render is
+	// progressive.
+	void restoreCheckpoint(const Checkpoint& checkpoint);
+	void start();
+	// blocks until every worker has parked
+	void pause();
+	void resume();
+	void stop();
+	// blocks until every worker has exited (render finished or stopped)
+	void wait();
+	bool isDone() const;
+	size_t getThreadCount() const;
+	unsigned int getTileSize() const;
+	// in progressive renders, these count each pass over a tile separately
+	size_t getTileCount() const;
+	// includes tiles skipped because a checkpoint or StreamedImage already had them
+	size_t getCompletedTileCount() const;
+	// Finished tiles are only recorded (for takeCompletedTiles) while a preview is
+	// attached. Attaching queues every tile, so whatever the Framebuffer already
+	// holds (such as tiles restored from a checkpoint) is shown too; detaching
+	// drops any tiles not taken yet. Safe to call while rendering.
+	void attachPreview();
+	void detachPreview();
+	std::vector<Tile> takeCompletedTiles();
+	unsigned int getImageWidth() const;
+	unsigned int getImageHeight() const;
+	// safe to read from any thread while rendering. Only exists once started (or
+	// restored from a checkpoint), and never when streaming.
+	const Framebuffer& getFramebuffer() const;
+	// complete once isDone()
+	BVHTraversalStats getTraversalStats();
+	// complete once isDone()
+	RayCounts getRayCounts();
+	// average primary rays per pixel, over pixels rendered with adaptive sampling
+	// so far (0 if none have been)
+	double getAverageSampleCount() const;
+	static size_t getDefaultThreadCount();
+};
+
+
+#endif //RAYTRACER_RENDERER_HPP
@@ -0,0 +1,49 @@
+#include <cstdint>
+
+#include <src/hashBits.hpp>
+
+#include "SampleRandom.hpp"
+
+namespace {
+	const uint64_t pcg_multiplier = 6364136223846793005ull;
+
+	// scrambles the bits of value (the finalizer of SplitMix64), so neighbouring
+	// pixels get unrelated seeds
+	uint64_t hash(uint64_t value)
+	{
+		value ^= value >> 30;
+		value *= 0xbf58476d1ce4e5b9ull;
+		value ^= value >> 27;
+		value *= 0x94d049bb133111ebull;
+		value ^= value >> 31;
+		return value;
+	}
+}
+
+SampleRandom::SampleRandom(
+	const unsigned int& x,
+	const unsigned int& y,
+	const unsigned int& sample_index
+) : state(0),
+    increment(((uint64_t)sample_index << 1) | 1u)
+{
+	// seeded the way PCG's reference implementation does it
+	this->nextUint();
+	this->state += hash(((uint64_t)y << 32) | x);
+	this->nextUint();
+}
+
+uint32_t SampleRandom::nextUint()
+{
+	uint64_t old_state = this->state;
+	this->state = old_state * pcg_multiplier + this->increment;
+	// (the XSH RR output function)
+	uint32_t shifted = (uint32_t)(((old_state >> 18u) ^ old_state) >> 27u);
+	uint32_t rotation = (uint32_t)(old_state >> 59u);
+	return (shifted >> rotation) | (shifted << ((-rotation) & 31));
+}
+
+float SampleRandom::nextFloat()
+{
+	return toUnitFloat(this->nextUint());
+}
@@ -0,0 +1,30 @@
+#ifndef RAYTRACER_SAMPLERANDOM_HPP
+#define RAYTRACER_SAMPLERANDOM_HPP
+
+#include <cstdint>
+
+// Random numbers for tracing one sample of one pixel, from a PCG32 generator
+// (O'Neill, "PCG: A Family of Simple Fast Space-Efficient Statistically Good
+// Algorithms for Random Number Generation") seeded by the pixel and picking its
+// stream by the sample. The numbers drawn only depend on the pixel, the sample and
+// how many were drawn before, never on which thread traces it or when, so renders
+// using them come out exactly the same every time.
+
+class SampleRandom {
+private:
+	uint64_t state;
+	// odd, and different for every sample
+	uint64_t increment;
+public:
+	SampleRandom(
+		const unsigned int& x,
+		const unsigned int& y,
+		const unsigned int& sample_index
+	);
+	uint32_t nextUint();
+	// in [0, 1)
+	float nextFloat();
+};
+
+
+#endif //RAYTRACER_SAMPLERANDOM_HPP
@@ -0,0 +1,235 @@
+#include <boost/filesystem.hpp>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+#include "TileScheduler.hpp"
+#include "StreamedImage.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace {
+	// start of every sidecar, followed by the scene hash (uint64_t), image width,
+	// height and tile size, the render settings (integrator, min and max samples,
+	// then the sample threshold as a float), then an (x, y) record for each
+	// finished tile (all but the hash and threshold as uint32_t)
+	const char tiles_magic[] = "RTTILE2\n";
+	const size_t tiles_header_size =
+		sizeof(tiles_magic) - 1 + sizeof(uint64_t) + 6 * sizeof(uint32_t) +
+		sizeof(float);
+	const size_t tiles_record_size = 2 * sizeof(uint32_t);
+}
+
+StreamedImage::StreamedImage(
+	const std::string& filename,
+	unsigned int image_width,
+	unsigned int image_height,
+	unsigned int tile_size,
+	uint64_t scene_hash,
+	const RenderSettings& settings,
+	bool resume
+) : filename(filename),
+    tiles_filename(filename + ".tiles"),
+    image_width(image_width),
+    image_height(image_height),
+    tile_size(tile_size),
+    tile_columns((image_width + tile_size - 1) / tile_size),
+    scene_hash(scene_hash),
+    settings(settings),
+    completed_tile_count(0),
+    failed(false)
+{
+	std::string header =
+		"P6\n" + std::to_string(image_width) + " " + std::to_string(image_height) +
+		"\n255\n";
+	this->header_size = header.size();
+	uintmax_t file_size =
+		this->header_size + (uintmax_t)image_width * image_height * image_channels;
+	unsigned int tile_rows = (image_height + tile_size - 1) / tile_size;
+	this->completed_tiles.assign(this->tile_columns * tile_rows, false);
+
+	bool is_resuming = false;
+	if (resume && fs::exists(this->tiles_filename)) {
+		// the image itself also has to still be the one the sidecar describes
+		bool is_match =
+			this->readCompletedTiles() &&
+			fs::exists(filename) &&
+			fs::file_size(filename) == file_size;
+		if (is_match) {
+			std::ifstream existing_file(filename, std::ios::binary);
+			std::string existing_header(header.size(), '\0');
+			existing_file.read(&existing_header[0], existing_header.size());
+			is_match = existing_file && existing_header == header;
+		}
+		if (!is_match) {
+			throw std::runtime_error(
+				"Can't resume " + filename +
+					", since it's from a different scene, size or render settings."
+			);
+		}
+		is_resuming = true;
+	}
+
+	if (!is_resuming) {
+		std::ofstream new_file(filename, std::ios::binary | std::ios::trunc);
+		new_file << header;
+		new_file.close();
+		if (!new_file) {
+			throw std::runtime_error("Failed to create image file " + filename + ".");
+		}
+		// unwritten pixels read back as black (and take no disk space on most
+		// file systems)
+		fs::resize_file(filename, file_size);
+
+		std::ofstream new_tiles_file(
+			this->tiles_filename,
+			std::ios::binary | std::ios::trunc
+		);
+		uint32_t tiles_header[6] = {
+			image_width,
+			image_height,
+			tile_size,
+			settings.integrator,
+			settings.min_samples,
+			settings.max_samples
+		};
+		new_tiles_file.write(tiles_magic, sizeof(tiles_magic) - 1);
+		new_tiles_file.write((const char*)&scene_hash, sizeof(scene_hash));
+		new_tiles_file.write((const char*)tiles_header, sizeof(tiles_header));
+		new_tiles_file.write(
+			(const char*)&settings.sample_threshold,
+			sizeof(settings.sample_threshold)
+		);
+		new_tiles_file.close();
+		if (!new_tiles_file) {
+			throw std::runtime_error(
+				"Failed to create tile file " + this->tiles_filename + "."
+			);
+		}
+	}
+
+	this->pixels_file.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+	this->tiles_file.open(this->tiles_filename, std::ios::binary | std::ios::app);
+	if (!this->pixels_file || !this->tiles_file) {
+		throw std::runtime_error("Failed to open " + filename + " for writing.");
+	}
+}
+
+bool StreamedImage::readCompletedTiles()
+{
+	std::ifstream file(this->tiles_filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	char magic[sizeof(tiles_magic) - 1];
+	uint64_t tiles_scene_hash;
+	uint32_t tiles_header[6];
+	float tiles_sample_threshold;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&tiles_scene_hash, sizeof(tiles_scene_hash));
+	file.read((char*)tiles_header, sizeof(tiles_header));
+	file.read((char*)&tiles_sample_threshold, sizeof(tiles_sample_threshold));
+	if (
+		!file ||
+		std::memcmp(magic, tiles_magic, sizeof(magic)) != 0 ||
+		tiles_scene_hash != this->scene_hash ||
+		tiles_header[0] != this->image_width ||
+		tiles_header[1] != this->image_height ||
+		tiles_header[2] != this->tile_size ||
+		tiles_header[3] != this->settings.integrator ||
+		tiles_header[4] != this->settings.min_samples ||
+		tiles_header[5] != this->settings.max_samples ||
+		tiles_sample_threshold != this->settings.sample_threshold
+	) {
+		return false;
+	}
+
+	size_t record_count = 0;
+	uint32_t position[2];
+	while (file.read((char*)position, sizeof(position))) {
+		if (
+			position[0] % this->tile_size != 0 ||
+			position[1] % this->tile_size != 0 ||
+			position[0] >= this->image_width ||
+			position[1] >= this->image_height
+		) {
+			return false;
+		}
+		Tile tile = {position[0], position[1], this->tile_size, this->tile_size};
+		size_t index = this->getTileIndex(tile);
+		if (!this->completed_tiles[index]) {
+			this->completed_tiles[index] = true;
+			this->completed_tile_count++;
+		}
+		record_count++;
+	}
+	file.close();
+
+	// a record cut short by the process dying part way through writing it is
+	// dropped, so new records don't end up misaligned
+	fs::resize_file(
+		this->tiles_filename,
+		tiles_header_size + record_count * tiles_record_size
+	);
+	return true;
+}
+
+size_t StreamedImage::getTileIndex(const Tile& tile) const
+{
+	return (tile.y / this->tile_size) * this->tile_columns + tile.x / this->tile_size;
+}
+
+bool StreamedImage::isTileComplete(const Tile& tile) const
+{
+	return this->completed_tiles[this->getTileIndex(tile)];
+}
+
+size_t StreamedImage::getCompletedTileCount() const
+{
+	return this->completed_tile_count;
+}
+
+void StreamedImage::writeTile(const Tile& tile, const unsigned char* const& pixels)
+{
+	size_t row_size = tile.width * image_channels;
+
+	std::lock_guard<std::mutex> lock(this->mut);
+	for (unsigned int row = 0; row < tile.height; row++) {
+		std::streamoff pixel_offset =
+			(std::streamoff)(tile.y + row) * this->image_width + tile.x;
+		this->pixels_file.seekp(this->header_size + pixel_offset * image_channels);
+		this->pixels_file.write((const char*)pixels + row * row_size, row_size);
+	}
+	// pixels have to reach the file before the tile is recorded as done
+	this->pixels_file.flush();
+
+	uint32_t position[2] = {tile.x, tile.y};
+	this->tiles_file.write((const char*)position, sizeof(position));
+	this->tiles_file.flush();
+
+	if (!this->pixels_file || !this->tiles_file) {
+		this->failed = true;
+		return;
+	}
+	this->completed_tiles[this->getTileIndex(tile)] = true;
+	this->completed_tile_count++;
+}
+
+bool StreamedImage::finish()
+{
+	std::lock_guard<std::mutex> lock(this->mut);
+	this->pixels_file.close();
+	this->tiles_file.close();
+	if (this->failed || !this->pixels_file || !this->tiles_file) {
+		return false;
+	}
+	if (this->completed_tile_count == this->completed_tiles.size()) {
+		fs::remove(this->tiles_filename);
+	}
+	return true;
+}
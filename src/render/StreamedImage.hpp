@@ -0,0 +1,77 @@
+#ifndef RAYTRACER_STREAMEDIMAGE_HPP
+#define RAYTRACER_STREAMEDIMAGE_HPP
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <stdexcept>
+#include <cstdint>
+
+#include "TileScheduler.hpp"
+#include "RenderSettings.hpp"
+
+// An image file which finished tiles are written into as they complete, so a
+// render never needs the whole image in memory.
+//
+// Pixels go to a binary PPM, whose fixed-size header puts every pixel at a known
+// offset, so each tile row can be written in place. Once a tile's pixels are
+// flushed, its position is appended to a sidecar "<filename>.tiles" file. If the
+// render is interrupted (or the process killed), the sidecar records which tiles
+// made it to disk, and a later StreamedImage can resume from there, provided it's
+// for the same scene (going by the scene file's hash), dimensions, tile size and
+// render settings.
+// The sidecar is removed once every tile has been written.
+
+class StreamedImage {
+private:
+	std::string filename;
+	std::string tiles_filename;
+	unsigned int image_width;
+	unsigned int image_height;
+	unsigned int tile_size;
+	unsigned int tile_columns;
+	uint64_t scene_hash;
+	RenderSettings settings;
+	size_t header_size;
+	// indexed by tile row * tile_columns + tile column
+	std::vector<bool> completed_tiles;
+	size_t completed_tile_count;
+	bool failed;
+	std::mutex mut;
+	std::fstream pixels_file;
+	std::ofstream tiles_file;
+
+	// returns false if the sidecar doesn't match this image
+	bool readCompletedTiles();
+	size_t getTileIndex(const Tile& tile) const;
+public:
+	static const int image_channels = 3;
+	// starts a new (black) image in filename, or if resume is true and an earlier
+	// render to filename was interrupted, carries on from there.
+	// Throws std::runtime_error if the files can't be created, or if the render
+	// being resumed doesn't match this one.
+	StreamedImage(
+		const std::string& filename,
+		unsigned int image_width,
+		unsigned int image_height,
+		unsigned int tile_size,
+		uint64_t scene_hash,
+		const RenderSettings& settings,
+		bool resume
+	);
+	StreamedImage(const StreamedImage&) = delete;
+	StreamedImage& operator=(const StreamedImage&) = delete;
+	// true if tile was written by this or an earlier render
+	bool isTileComplete(const Tile& tile) const;
+	// number of tiles written, including those resumed from an earlier render
+	size_t getCompletedTileCount() const;
+	// tightly packed RGB rows of tile. Safe to call from several threads at once.
+	void writeTile(const Tile& tile, const unsigned char* const& pixels);
+	// closes the files, removing the sidecar if every tile has been written.
+	// Returns false if any write failed.
+	bool finish();
+};
+
+
+#endif //RAYTRACER_STREAMEDIMAGE_HPP
@@ -0,0 +1,64 @@
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+
+#include "TileScheduler.hpp"
+
+TileScheduler::TileScheduler(const std::vector<Tile>& tiles, size_t worker_count)
+{
+	for (size_t i = 0; i < worker_count; i++) {
+		this->queues.emplace_back(new WorkerQueue());
+	}
+	// deal tiles out round-robin, so every worker starts out with tiles spread
+	// evenly across the image (and the image fills in roughly top to bottom)
+	for (size_t i = 0, len = tiles.size(); i < len; i++) {
+		this->queues[i % worker_count]->tiles.push_back(tiles[i]);
+	}
+}
+
+bool TileScheduler::takeTile(size_t worker_index, Tile* const& tile)
+{
+	{
+		WorkerQueue& own_queue = *this->queues[worker_index];
+		std::lock_guard<std::mutex> lock(own_queue.mut);
+		if (!own_queue.tiles.empty()) {
+			*tile = own_queue.tiles.front();
+			own_queue.tiles.pop_front();
+			return true;
+		}
+	}
+	// steal from the other workers, starting with our neighbor so that idle
+	// workers don't all pile onto the same queue
+	for (size_t i = 1, len = this->queues.size(); i < len; i++) {
+		WorkerQueue& victim_queue = *this->queues[(worker_index + i) % len];
+		std::lock_guard<std::mutex> lock(victim_queue.mut);
+		if (!victim_queue.tiles.empty()) {
+			*tile = victim_queue.tiles.back();
+			victim_queue.tiles.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<Tile> TileScheduler::makeTiles(
+	unsigned int image_width,
+	unsigned int image_height,
+	unsigned int tile_size
+)
+{
+	std::vector<Tile> tiles;
+	for (unsigned int y = 0; y < image_height; y += tile_size) {
+		for (unsigned int x = 0; x < image_width; x += tile_size) {
+			tiles.push_back({
+				x,
+				y,
+				std::min(tile_size, image_width - x),
+				std::min(tile_size, image_height - y)
+			});
+		}
+	}
+	return tiles;
+}
@@ -0,0 +1,42 @@
+#ifndef RAYTRACER_TILESCHEDULER_HPP
+#define RAYTRACER_TILESCHEDULER_HPP
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+
+struct Tile {
+	unsigned int x;
+	unsigned int y;
+	unsigned int width;
+	unsigned int height;
+};
+
+// Work-stealing distribution of tiles across a fixed number of workers.
+// Each worker has its own queue, which it takes from the front of. Once that runs
+// dry it steals from the back of the other workers' queues, so the work left at
+// the end of a render is spread across every thread instead of waiting on one.
+
+class TileScheduler {
+private:
+	struct WorkerQueue {
+		std::mutex mut;
+		std::deque<Tile> tiles;
+	};
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+public:
+	TileScheduler(const std::vector<Tile>& tiles, size_t worker_count);
+	// if return is true, *tile is set to the next tile worker_index should render
+	bool takeTile(size_t worker_index, Tile* const& tile);
+	// splits the image into tiles no bigger than tile_size x tile_size, in
+	// row-major order
+	static std::vector<Tile> makeTiles(
+		unsigned int image_width,
+		unsigned int image_height,
+		unsigned int tile_size
+	);
+};
+
+
+#endif //RAYTRACER_TILESCHEDULER_HPP